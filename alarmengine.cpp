@@ -0,0 +1,226 @@
+#include "alarmengine.h"
+#include "sampleclock.h"
+#include <QProcess>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
+
+// Сколько событий может ждать рассылки; при зависшем приёмнике старые отбрасываются
+#define ALARM_QUEUE_MAX 1024
+
+CommandAlarmSink::CommandAlarmSink(const QString& program, const QStringList& arguments)
+    : program_(program), arguments_(arguments)
+{}
+
+void CommandAlarmSink::notify(const AlarmEvent& event) {
+    QStringList args;
+    args.reserve(arguments_.size());
+    for (QString a : arguments_) {
+        a.replace("%rule", event.rule);
+        a.replace("%state", event.raised ? QStringLiteral("ALARM") : QStringLiteral("CLEAR"));
+        a.replace("%value", QString::number(event.value, 'f', 2));
+        a.replace("%time", event.time.toString("yyyy-MM-dd HH:mm:ss"));
+        args.append(a);
+    }
+    // не ждём завершения — следующие события не должны стоять за скриптом
+    if (!QProcess::startDetached(program_, args))
+        qWarning("AlarmEngine: cannot start alarm command.");
+}
+
+FileAlarmSink::FileAlarmSink(const QString& path)
+    : file_(path)
+{
+    const QFileInfo fi(path);
+    if (!fi.absoluteDir().exists())
+        QDir().mkpath(fi.absolutePath());
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        qWarning("AlarmEngine: cannot open alarm log.");
+}
+
+void FileAlarmSink::notify(const AlarmEvent& event) {
+    if (!file_.isOpen())
+        return;
+    const QString line = QString("%1\t%2\t%3\t%4\t%5us\n")
+                             .arg(event.time.toString("yyyy-MM-dd HH:mm:ss.zzz"),
+                                  event.raised ? QStringLiteral("ALARM") : QStringLiteral("CLEAR"),
+                                  event.rule,
+                                  QString::number(event.value, 'f', 2).replace(".", ","))
+                             .arg(event.latencyNs / 1000);
+    file_.write(line.toUtf8());
+    file_.flush();
+}
+
+AlarmEngine::AlarmEngine() {
+    qRegisterMetaType<AlarmEvent>("AlarmEvent");
+    notifier_ = QThread::create([this]{ notifierLoop(); });
+    notifier_->setObjectName("alarm-notify");
+    notifier_->start();
+}
+
+AlarmEngine::~AlarmEngine() {
+    {
+        QMutexLocker lock(&queueMutex_);
+        stopping_ = true;
+        queueWait_.wakeAll();
+    }
+    notifier_->wait();
+    delete notifier_;
+}
+
+void AlarmEngine::notifierLoop() {
+    for (;;) {
+        QMutexLocker lock(&queueMutex_);
+        while (queue_.empty() && !stopping_)
+            queueWait_.wait(&queueMutex_);
+        if (queue_.empty())
+            return;     // остановка, очередь разослана
+        const AlarmEvent e = queue_.front();
+        queue_.pop_front();
+        const auto sinks = sinks_;
+        lock.unlock();
+        // приёмники — без блокировки: поток ввода-вывода в это время ставит новые события
+        for (const auto& sink : sinks)
+            sink->notify(e);
+    }
+}
+
+void AlarmEngine::setRules(const QVector<AlarmRule>& rules) {
+    QMutexLocker lock(&mutex_);
+    rules_.clear();
+    historyWindowSec_ = 0.0;
+    for (const AlarmRule& r : rules) {
+        RuleState st;
+        st.rule = r;
+        rules_.append(st);
+        if (r.type == AlarmRule::RateOfRise)
+            historyWindowSec_ = qMax(historyWindowSec_, r.windowSec);
+    }
+}
+
+void AlarmEngine::addSink(std::unique_ptr<AlarmSink> sink) {
+    QMutexLocker lock(&queueMutex_);
+    sinks_.push_back(std::shared_ptr<AlarmSink>(std::move(sink)));
+}
+
+QVector<AlarmEvent> AlarmEngine::onSample(double temperature, qint64 arrivalNs, qint64 latencyFromNs) {
+    QVector<AlarmEvent> events;
+    QMutexLocker lock(&mutex_);
+
+    lastSampleNs_ = arrivalNs;
+    if (historyWindowSec_ > 0) {
+        history_.emplace_back(arrivalNs, temperature);
+        const qint64 horizon = arrivalNs - qint64(historyWindowSec_ * 1e9);
+        while (history_.size() > 1 && history_.front().first < horizon)
+            history_.pop_front();
+    }
+
+    for (RuleState& st : rules_) {
+        const AlarmRule& r = st.rule;
+        switch (r.type) {
+        case AlarmRule::HighThreshold:
+            update(st, temperature > r.threshold,
+                   temperature < r.threshold - r.hysteresis, temperature, events);
+            break;
+        case AlarmRule::LowThreshold:
+            update(st, temperature < r.threshold,
+                   temperature > r.threshold + r.hysteresis, temperature, events);
+            break;
+        case AlarmRule::RateOfRise: {
+            // самый старый отсчёт внутри окна этого правила
+            const qint64 from = arrivalNs - qint64(r.windowSec * 1e9);
+            auto it = history_.begin();
+            while (it != history_.end() && it->first < from)
+                ++it;
+            if (it == history_.end())
+                break;
+            const double dtMin = (arrivalNs - it->first) / 60e9;
+            if (dtMin * 60.0 < r.windowSec * 0.5)
+                break;  // окно ещё не набрано
+            const double rate = (temperature - it->second) / dtMin;
+            update(st, rate > r.threshold, rate < r.threshold - r.hysteresis, rate, events);
+            break;
+        }
+        case AlarmRule::StaleData:
+            update(st, false, true, 0.0, events);
+            break;
+        case AlarmRule::Disconnected:
+            break;
+        }
+    }
+    dispatch(events, latencyFromNs ? latencyFromNs : arrivalNs);
+    return events;
+}
+
+QVector<AlarmEvent> AlarmEngine::onTick(qint64 nowNs, bool connected, qint64 latencyFromNs) {
+    QVector<AlarmEvent> events;
+    QMutexLocker lock(&mutex_);
+
+    if (!connected && disconnectedSinceNs_ == 0)
+        disconnectedSinceNs_ = nowNs;
+    else if (connected)
+        disconnectedSinceNs_ = 0;
+    if (connected && connectedSinceNs_ == 0)
+        connectedSinceNs_ = nowNs;
+    else if (!connected)
+        connectedSinceNs_ = 0;
+
+    // Возраст данных — от последнего отсчёта или от подключения, если отсчётов
+    // после него не было: устройство, молчащее на 0x20 с запуска, тоже тревога
+    const qint64 freshSinceNs = qMax(lastSampleNs_, connectedSinceNs_);
+    for (RuleState& st : rules_) {
+        const AlarmRule& r = st.rule;
+        if (r.type == AlarmRule::StaleData && freshSinceNs != 0) {
+            const double age = (nowNs - freshSinceNs) / 1e9;
+            update(st, age > r.threshold, false, age, events);
+        } else if (r.type == AlarmRule::Disconnected) {
+            const double down = disconnectedSinceNs_ ? (nowNs - disconnectedSinceNs_) / 1e9 : 0.0;
+            update(st, down > r.threshold, connected, down, events);
+        }
+    }
+    dispatch(events, latencyFromNs ? latencyFromNs : nowNs);
+    return events;
+}
+
+void AlarmEngine::update(RuleState& st, bool condition, bool clearCondition, double value,
+                         QVector<AlarmEvent>& out) {
+    if (!st.active && condition)
+        st.active = true;
+    else if (st.active && clearCondition)
+        st.active = false;
+    else
+        return;
+    AlarmEvent e;
+    e.rule = st.rule.name;
+    e.type = st.rule.type;
+    e.raised = st.active;
+    e.value = value;
+    out.append(e);
+}
+
+void AlarmEngine::dispatch(QVector<AlarmEvent>& events, qint64 sinceNs) {
+    if (events.isEmpty())
+        return;
+    const QDateTime now = QDateTime::currentDateTime();
+    const qint64 detectedNs = SampleClock::monotonicNs() - sinceNs;
+    for (AlarmEvent& e : events) {
+        e.time = now;
+        e.latencyNs = detectedNs;
+    }
+    {
+        // приёмники работают в потоке рассылки — здесь только очередь
+        QMutexLocker lock(&queueMutex_);
+        for (const AlarmEvent& e : events) {
+            if (queue_.size() >= ALARM_QUEUE_MAX) {
+                queue_.pop_front();
+                qWarning("AlarmEngine: notify queue full, dropping oldest event.");
+            }
+            queue_.push_back(e);
+        }
+        queueWait_.wakeOne();
+    }
+    // задержка до постановки в очередь — она ограничена, раздача по приёмникам нет
+    const qint64 total = SampleClock::monotonicNs() - sinceNs;
+    if (total > maxLatencyNs_.load(std::memory_order_relaxed))
+        maxLatencyNs_.store(total, std::memory_order_relaxed);
+}
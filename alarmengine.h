@@ -0,0 +1,129 @@
+#ifndef ALARMENGINE_H
+#define ALARMENGINE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QDateTime>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFile>
+#include <QMetaType>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class QThread;
+
+struct AlarmRule {
+    enum Type {
+        HighThreshold,   // температура выше threshold, °C
+        LowThreshold,    // температура ниже threshold, °C
+        RateOfRise,      // рост быстрее threshold °C/мин на окне windowSec
+        StaleData,       // нет отсчётов дольше threshold с
+        Disconnected,    // устройство отключено дольше threshold с
+    };
+
+    Type    type = HighThreshold;
+    QString name;
+    double  threshold = 0.0;
+    double  windowSec = 60.0;    // только для RateOfRise
+    double  hysteresis = 0.2;    // для порогов: сброс после возврата на столько °C
+};
+
+struct AlarmEvent {
+    QString   rule;
+    int       type = AlarmRule::HighThreshold;
+    bool      raised = true;     // true — тревога, false — отбой
+    double    value = 0.0;       // значение, вызвавшее срабатывание
+    QDateTime time;
+    qint64    latencyNs = 0;     // от прихода отчёта до раздачи по приёмникам
+};
+Q_DECLARE_METATYPE(AlarmEvent)
+
+// Приёмник уведомлений. Вызывается в отдельном потоке рассылки, а не в потоке
+// ввода-вывода: медленный диск или fork/exec не задерживают чтение HID.
+class AlarmSink {
+public:
+    virtual ~AlarmSink() = default;
+    virtual void notify(const AlarmEvent& event) = 0;
+};
+
+// Запуск внешней команды без ожидания. В аргументах подставляются
+// %rule, %state (ALARM/CLEAR), %value, %time.
+class CommandAlarmSink : public AlarmSink {
+public:
+    CommandAlarmSink(const QString& program, const QStringList& arguments);
+    void notify(const AlarmEvent& event) override;
+private:
+    QString     program_;
+    QStringList arguments_;
+};
+
+// Строка в файле журнала тревог; файл держим открытым.
+class FileAlarmSink : public AlarmSink {
+public:
+    explicit FileAlarmSink(const QString& path);
+    void notify(const AlarmEvent& event) override;
+private:
+    QFile file_;
+};
+
+// Движок тревог. Правила проверяются на каждом декодированном отсчёте прямо
+// в потоке HID, поэтому подвисание GUI (replot, ротация лога) не задерживает
+// обнаружение. Каждое правило защёлкивается: одно уведомление на срабатывание
+// и одно — на отбой. Приёмникам события уходят через очередь, которую
+// разбирает собственный поток движка.
+class AlarmEngine {
+public:
+    AlarmEngine();
+    ~AlarmEngine();             // дорассылает очередь и останавливает поток
+
+    // Настройка — из любого потока
+    void setRules(const QVector<AlarmRule>& rules);
+    void addSink(std::unique_ptr<AlarmSink> sink);
+
+    // Вызываются только из потока ввода-вывода.
+    // arrivalNs — монотонное время возврата hid_read_timeout.
+    // latencyFromNs — от какого момента считать задержку, если он не совпадает
+    // со временем данных (прогон записи); 0 — от arrivalNs/nowNs.
+    QVector<AlarmEvent> onSample(double temperature, qint64 arrivalNs, qint64 latencyFromNs = 0);
+    QVector<AlarmEvent> onTick(qint64 nowNs, bool connected, qint64 latencyFromNs = 0);
+
+    // Наибольшая задержка «отчёт пришёл → тревога обнаружена и поставлена в очередь
+    // рассылки» за сеанс; задержка отдельной тревоги — в AlarmEvent::latencyNs
+    qint64 maxLatencyNs() const { return maxLatencyNs_.load(std::memory_order_relaxed); }
+
+private:
+    struct RuleState {
+        AlarmRule rule;
+        bool active = false;
+    };
+
+    void update(RuleState& st, bool condition, bool clearCondition, double value,
+                QVector<AlarmEvent>& out);
+    void dispatch(QVector<AlarmEvent>& events, qint64 sinceNs);
+    void notifierLoop();
+
+    QMutex mutex_;
+    QVector<RuleState> rules_;
+
+    // рассылка: очередь и приёмники под queueMutex_
+    QMutex queueMutex_;
+    QWaitCondition queueWait_;
+    std::deque<AlarmEvent> queue_;
+    std::vector<std::shared_ptr<AlarmSink>> sinks_;
+    bool stopping_ = false;
+    QThread* notifier_ = nullptr;
+
+    std::deque<std::pair<qint64, double>> history_;  // для скорости роста
+    double historyWindowSec_ = 0.0;
+    qint64 lastSampleNs_ = 0;
+    qint64 disconnectedSinceNs_ = 0;
+    qint64 connectedSinceNs_ = 0;     // от него считается «нет данных», пока нет отсчётов
+
+    std::atomic<qint64> maxLatencyNs_{0};
+};
+
+#endif // ALARMENGINE_H
@@ -0,0 +1,114 @@
+#include "hidcapture.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+#include <QDebug>
+
+static const char CAPTURE_MAGIC[8] = {'F', 'R', 'Z', 'H', 'I', 'D', 'C', '1'};
+static const int  CAPTURE_HEADER_SIZE = 8 + 8 + 8;
+static const qint64 FLUSH_INTERVAL_NS = 1000000000LL;
+
+HidCaptureWriter::~HidCaptureWriter() {
+    close();
+}
+
+bool HidCaptureWriter::open(const QString& path, const SampleTime& anchor) {
+    close();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "HID capture: cannot open" << path << file_.errorString();
+        return false;
+    }
+    char header[CAPTURE_HEADER_SIZE];
+    memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    qToLittleEndian<qint64>(anchor.monoNs, header + 8);
+    qToLittleEndian<qint64>(anchor.wallMs, header + 16);
+    file_.write(header, sizeof(header));
+    file_.flush();
+    lastNs_ = anchor.monoNs;
+    lastFlushNs_ = anchor.monoNs;
+    return true;
+}
+
+void HidCaptureWriter::close() {
+    if (file_.isOpen()) {
+        file_.flush();
+        file_.close();
+    }
+}
+
+void HidCaptureWriter::append(HidCapture::Kind kind, qint64 monoNs, const uchar* data, int len) {
+    if (!file_.isOpen())
+        return;
+    len = qBound(0, len, 255);
+    // время в записи только растёт — дельта всегда неотрицательна
+    quint64 deltaUs = quint64(qMax<qint64>(0, monoNs - lastNs_) / 1000);
+    lastNs_ += qint64(deltaUs) * 1000;
+
+    char buf[2 + 10 + 255];
+    int n = 0;
+    buf[n++] = char(kind);
+    buf[n++] = char(len);
+    do {
+        quint8 b = deltaUs & 0x7f;
+        deltaUs >>= 7;
+        if (deltaUs)
+            b |= 0x80;
+        buf[n++] = char(b);
+    } while (deltaUs);
+    if (len > 0)
+        memcpy(buf + n, data, size_t(len));
+    file_.write(buf, n + len);
+
+    if (monoNs - lastFlushNs_ >= FLUSH_INTERVAL_NS || kind == HidCapture::Disconnected) {
+        file_.flush();
+        lastFlushNs_ = monoNs;
+    }
+}
+
+bool HidCaptureReader::open(const QString& path) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        error_ = f.errorString();
+        return false;
+    }
+    data_ = f.readAll();
+    if (data_.size() < CAPTURE_HEADER_SIZE || memcmp(data_.constData(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+        error_ = "not a HID capture file";
+        return false;
+    }
+    anchorMonoNs_ = qFromLittleEndian<qint64>(data_.constData() + 8);
+    anchorWallMs_ = qFromLittleEndian<qint64>(data_.constData() + 16);
+    lastNs_ = anchorMonoNs_;
+    pos_ = CAPTURE_HEADER_SIZE;
+    return true;
+}
+
+bool HidCaptureReader::next(HidCapture::Record* record) {
+    const uchar* p = reinterpret_cast<const uchar*>(data_.constData());
+    const int size = data_.size();
+    int pos = pos_;
+    if (pos + 2 > size)
+        return false;
+    const quint8 kind = p[pos++];
+    const int len = p[pos++];
+    quint64 deltaUs = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (pos >= size || shift > 63)
+            return false;
+        const quint8 b = p[pos++];
+        deltaUs |= quint64(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    if (pos + len > size || kind > HidCapture::Disconnected)
+        return false;   // файл дописывался во время сбоя — хвост отбрасываем
+
+    lastNs_ += qint64(deltaUs) * 1000;
+    record->kind = HidCapture::Kind(kind);
+    record->monoNs = lastNs_;
+    record->data = QByteArray(data_.constData() + pos, len);
+    pos_ = pos + len;
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef HIDCAPTURE_H
+#define HIDCAPTURE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include "sampleclock.h"
+
+// Запись сырого обмена с контроллером для разбора полевых проблем и прогона
+// на стенде. Формат (little-endian):
+//   заголовок: "FRZHIDC1" [i64 якорь monoNs] [i64 якорь wallMs]
+//   запись:    [u8 kind] [u8 len] [varint Δмкс от предыдущей записи] [len байт]
+// Обычная запись отчёта — 3–4 байта служебных + сам отчёт.
+namespace HidCapture {
+
+enum Kind : quint8 {
+    In           = 0,   // отчёт от устройства
+    Out          = 1,   // отчёт в устройство (без нулевого report ID)
+    Connected    = 2,   // hid_open удался
+    Disconnected = 3,   // ошибка чтения/записи, устройство закрыто
+};
+
+struct Record {
+    Kind       kind = In;
+    qint64     monoNs = 0;  // время записи по часам исходной сессии
+    QByteArray data;
+};
+
+} // namespace HidCapture
+
+// Пишет только поток ввода-вывода HidWorker. Буферизуется QFile, на диск
+// сбрасывается не реже раза в секунду — при падении теряем не больше секунды.
+class HidCaptureWriter {
+public:
+    ~HidCaptureWriter();
+
+    bool open(const QString& path, const SampleTime& anchor);
+    void close();
+    bool isOpen() const { return file_.isOpen(); }
+
+    void append(HidCapture::Kind kind, qint64 monoNs, const uchar* data, int len);
+
+private:
+    QFile  file_;
+    qint64 lastNs_ = 0;
+    qint64 lastFlushNs_ = 0;
+};
+
+class HidCaptureReader {
+public:
+    bool open(const QString& path);
+    QString errorString() const { return error_; }
+
+    qint64 anchorMonoNs() const { return anchorMonoNs_; }
+    qint64 anchorWallMs() const { return anchorWallMs_; }
+
+    // false — конец файла или оборванная последняя запись
+    bool next(HidCapture::Record* record);
+
+private:
+    QByteArray data_;
+    int        pos_ = 0;
+    qint64     lastNs_ = 0;
+    qint64     anchorMonoNs_ = 0;
+    qint64     anchorWallMs_ = 0;
+    QString    error_;
+};
+
+#endif // HIDCAPTURE_H
@@ -0,0 +1,73 @@
+#ifndef HIDPROTOCOL_H
+#define HIDPROTOCOL_H
+
+#include <QtEndian>
+#include <cstring>
+
+// Протокол обмена с контроллером (little-endian).
+//
+// Классический отчёт — 8 байт: 4 байта команды + 4 байта значения.
+//
+// Упакованный отчёт (до 64 байт, если прошивка согласилась на SetReportSize):
+//   [u32 PackedReport][u8 count][u8 reserved][u16 seq]
+//   count записей по 8 байт: [u8 command][u8 reserved][u16 ageMs][4 байта значения]
+// ageMs — сколько миллисекунд назад прошивка сняла значение до отправки отчёта.
+namespace HidProtocol {
+
+constexpr int LegacyReportSize = 8;
+constexpr int MaxReportSize = 64;
+constexpr int PackedHeaderSize = 8;
+constexpr int PackedRecordSize = 8;
+
+enum Command : quint32 {
+    SetTemperature      = 0x10,
+    SetPidP             = 0x11,
+    SetPidD             = 0x12,
+    SetCompressorOnTime = 0x13,
+    SetCycleTime        = 0x14,
+
+    GetTemperature      = 0x20,
+    GetPidP             = 0x21,
+    GetPidD             = 0x22,
+    GetCompressorOnTime = 0x23,
+    GetCycleTime        = 0x24,
+    GetSetPoint         = 0x25,
+
+    SetReportSize       = 0x30,   // запрос/подтверждение размера отчёта, значение — u32 байт
+    PackedReport        = 0x40,   // заголовок упакованного отчёта
+};
+
+inline quint32 readU32(const uchar* p) {
+    return qFromLittleEndian<quint32>(p);
+}
+
+inline float readFloat(const uchar* p) {
+    const quint32 u = readU32(p);
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// Разобрать входной отчёт любого формата. Для каждого значения вызывается
+// f(quint32 command, const uchar* payload, int ageMs). Возвращает число значений.
+template <typename F>
+int decode(const uchar* buf, int len, F&& f) {
+    if (len < LegacyReportSize)
+        return 0;
+    const quint32 command = readU32(buf);
+    if (command != PackedReport) {
+        f(command, buf + 4, 0);
+        return 1;
+    }
+    const int count = buf[4];
+    if (PackedHeaderSize + count * PackedRecordSize > len)
+        return 0;  // обрезанный отчёт — не доверяем ни одной записи
+    const uchar* rec = buf + PackedHeaderSize;
+    for (int i = 0; i < count; ++i, rec += PackedRecordSize)
+        f(quint32(rec[0]), rec + 4, int(qFromLittleEndian<quint16>(rec + 2)));
+    return count;
+}
+
+} // namespace HidProtocol
+
+#endif // HIDPROTOCOL_H
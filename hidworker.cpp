@@ -1,50 +1,75 @@
 #include "hidworker.h"
+#include "hidprotocol.h"
 #include <QThread>
-#include <QtConcurrent/QtConcurrent>
+#include <QProcess>
+#include <QDebug>
+
+#if defined(Q_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+// Самое долгое блокирующее ожидание в цикле — от него зависит, как быстро
+// цикл замечает stop() и новые пакеты на отправку.
+#define IO_WAIT_MAX_MS 20
+
+// Как часто сверять настенное время отсчётов с системными часами
+#define CLOCK_RESYNC_NS 1000000000LL
+
+// Сколько сигналов dataReceived может ждать GUI при прогоне «как можно быстрее»
+#define REPLAY_MAX_IN_FLIGHT 64
 
 HidWorker::HidWorker(uint16_t vid, uint16_t pid, QObject* parent)
     : QObject(parent), m_vid(vid), m_pid(pid)
 {}
 
 HidWorker::~HidWorker() {
-    stop();
+    // Поток работает с this (m_mutex, m_alarms, m_store) — здесь ждём его без
+    // предела. Если ждать нельзя, владелец не удаляет воркер (см. ~MainWindow).
+    requestStop();
+    if (m_ioThread) {
+        m_ioThread->wait();
+        delete m_ioThread;
+        m_ioThread = nullptr;
+    }
 }
 
 void HidWorker::start() {
-    if (hid_init() != 0) {
-        qDebug() << "hid_init failed";
-        emit errorOccurred("hid_init failed");
-        return;
-    }
-    m_handle = hid_open(m_vid, m_pid, nullptr);
-    if (!m_handle) {
-        qDebug() << "hid_open failed";
-        emit errorOccurred("hid_open failed");
-        hid_exit();
+    QMutexLocker lock(&m_mutex);
+    if (m_running || m_ioThread)
         return;
-    }
-    // НЕ блокировать hid_read
-    hid_set_nonblocking(m_handle, 1);
-
-    m_mutex.lock();
     m_running = true;
-    m_mutex.unlock();
-
-    // Запускаем цикл в этом же потоке
-    QtConcurrent::run([this]{ loop(); });
+    m_ioThread = QThread::create([this]{ loop(); });
+    m_ioThread->setObjectName("hid-io");
+    m_ioThread->start();
 }
 
-void HidWorker::stop() {
-    m_mutex.lock();
+void HidWorker::requestStop() {
+    QMutexLocker lock(&m_mutex);
     m_running = false;
     m_wait.wakeAll();
-    m_mutex.unlock();
-    if (m_handle) {
-        hid_close(m_handle);
-        hid_exit();
-        m_handle = nullptr;
+}
+
+bool HidWorker::stop() {
+    requestStop();
+    if (!m_ioThread)
+        return true;
+
+    // Ожидания в цикле не длиннее IO_WAIT_MAX_MS, но hid_open/hid_write могут
+    // зависнуть дольше. Тогда поток остаётся за объектом: его дождётся деструктор,
+    // так что this и store переживут поток. Устройство закрывает сам поток.
+    if (!m_ioThread->wait(m_joinTimeoutMs)) {
+        qWarning() << "HidWorker: I/O thread did not stop in" << m_joinTimeoutMs << "ms";
+        return false;
     }
-    emit finished();
+    delete m_ioThread;
+    m_ioThread = nullptr;
+    return true;
 }
 
 void HidWorker::sendData(const QByteArray &data) {
@@ -54,84 +79,395 @@ void HidWorker::sendData(const QByteArray &data) {
     m_wait.wakeOne();
 }
 
+PollJitter HidWorker::pollJitter() const {
+    QMutexLocker lock(&m_mutex);
+    return m_jitter;
+}
+
+ReplayStats HidWorker::replayStats() const {
+    QMutexLocker lock(&m_mutex);
+    return m_replayStats;
+}
+
+void HidWorker::dataConsumed() {
+    if (!isReplay())
+        return;
+    const qint64 now = SampleClock::monotonicNs();
+    QMutexLocker lock(&m_mutex);
+    if (m_replayEmitNs.isEmpty())
+        return;
+    // очередь сигналов упорядочена — обработан самый старый из отправленных
+    const qint64 us = (now - m_replayEmitNs.dequeue()) / 1000;
+    ReplayStats &st = m_replayStats;
+    ++st.delivered;
+    st.maxDeliveryUs = qMax(st.maxDeliveryUs, us);
+    st.meanDeliveryUs += (us - st.meanDeliveryUs) / double(st.delivered);
+    m_wait.wakeAll();
+}
+
+bool HidWorker::isRunning() {
+    QMutexLocker lock(&m_mutex);
+    return m_running;
+}
+
+void HidWorker::sleepInterruptible(int ms) {
+    QMutexLocker lock(&m_mutex);
+    if (m_running)
+        m_wait.wait(&m_mutex, ms);
+}
+
+void HidWorker::applyThreadPolicy() {
+#if defined(Q_OS_LINUX)
+    if (m_fifoPriority > 0) {
+        sched_param sp{};
+        sp.sched_priority = m_fifoPriority;
+        const int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (rc != 0) {
+            qWarning() << "HidWorker: SCHED_FIFO unavailable (" << rc << "), falling back to nice";
+            if (m_nice == 0)
+                m_nice = -10;
+        }
+    }
+    if (m_nice != 0 && setpriority(PRIO_PROCESS, pid_t(syscall(SYS_gettid)), m_nice) != 0)
+        qWarning() << "HidWorker: cannot set nice" << m_nice;
+    if (m_cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(m_cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            qWarning() << "HidWorker: cannot pin I/O thread to CPU" << m_cpu;
+    }
+#elif defined(Q_OS_WIN)
+    if (m_fifoPriority > 0 || m_nice < 0)
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    if (m_cpu >= 0 && m_cpu < 64)
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << m_cpu);
+#else
+    if (m_fifoPriority > 0 || m_nice < 0)
+        QThread::currentThread()->setPriority(QThread::TimeCriticalPriority);
+#endif
+}
+
+bool HidWorker::writePacket(const QByteArray &packet) {
+    QByteArray buf;
+    buf.resize(1 + packet.size());
+    buf[0] = 0;
+    memcpy(buf.data()+1, packet.data(), packet.size());
+
+    int w = hid_write(m_handle, reinterpret_cast<unsigned char*>(buf.data()), buf.size());
+    if (w < 0) {
+        emit errorOccurred(QString("Write error: %1. Lost device?").arg(hid_error(m_handle)));
+        closeDevice();
+        return false;
+    }
+    m_capture.append(HidCapture::Out, SampleClock::monotonicNs(),
+                     reinterpret_cast<const uchar*>(packet.constData()), packet.size());
+    return true;
+}
+
+void HidWorker::closeDevice() {
+    const SampleTime stamp = m_clock.now();
+    publishLink(false, stamp);
+    if (m_handle) {
+        m_capture.append(HidCapture::Disconnected, stamp.monoNs, nullptr, 0);
+        hid_close(m_handle);
+        m_handle = nullptr;
+    }
+}
+
 void HidWorker::loop() {
+    applyThreadPolicy();
 
-    while (true) {
-        m_mutex.lock();
-        if (!m_running) {
-            m_mutex.unlock();
-            break;
+    if (isReplay()) {
+        replayLoop();
+        return;
+    }
+    if (!m_capturePath.isEmpty() && m_capture.open(m_capturePath, m_clock.now()))
+        qDebug() << "HID capture:" << m_capturePath;
+
+    if (hid_init() != 0) {
+        qDebug() << "hid_init failed";
+        emit errorOccurred("hid_init failed");
+        emit finished();
+        return;
+    }
+
+    const qint64 pollNs = qint64(m_pollIntervalMs) * 1000000;
+    qint64 nextPollNs = SampleClock::monotonicNs();
+    const QByteArray pollPacket(1, char(HidProtocol::GetTemperature));
+    // уставку прошивка сама не присылает — без неё нет полосы, перерегулирования
+    // и ступеньки уставки на графике
+    const QByteArray setpointPacket(1, char(HidProtocol::GetSetPoint));
+    qint64 nextResyncNs = SampleClock::monotonicNs() + CLOCK_RESYNC_NS;
+
+    while (isRunning()) {
+        // тревоги по времени: устаревшие данные и длительное отключение
+        const qint64 tickNs = SampleClock::monotonicNs();
+        emitAlarms(m_alarms.onTick(tickNs, m_handle != nullptr));
+
+        // якорь ставится при подключении, а сессия может длиться неделями:
+        // подхватываем шаги NTP и не даём накопиться дрейфу монотонных часов
+        if (tickNs >= nextResyncNs) {
+            nextResyncNs = tickNs + CLOCK_RESYNC_NS;
+            if (const qint64 driftMs = m_clock.resyncIfDrifted())
+                qDebug() << "HidWorker: wall clock re-anchored, drift" << driftMs << "ms";
         }
-        m_mutex.unlock();
 
         if (!m_handle) {
             m_handle = hid_open(m_vid, m_pid, nullptr);
             if (m_handle) {
-                hid_set_nonblocking(m_handle, 1);
-                qDebug() << "Device reconnected!";
-                emit errorOccurred("Device reconnected!");
+                m_clock.reanchor();
+                const SampleTime stamp = m_clock.now();
+                m_capture.append(HidCapture::Connected, stamp.monoNs, nullptr, 0);
+                publishLink(true, stamp);
+                qDebug() << "Device connected!";
+                emit errorOccurred("Device connected!");
                 attepmtReconect = 0;
+                nextPollNs = SampleClock::monotonicNs();
+                if (!negotiateReportSize() || !writePacket(setpointPacket))
+                    continue;   // устройство уже закрыто — переподключаемся
             } else {
                 emit errorOccurred("Device not found, reconnecting...");
                 qDebug() << "Device not found, reconnecting...";
                 if (++attepmtReconect > 15) {
                     QString deviceId = "USB\\VID_3210&PID_0098\\xxxxxxxx"; // подбери свой!
-                    int devconResult = QProcess::execute("devcon", {"restart", deviceId});
-                    qDebug() << "devcon restart result:" << devconResult;
-                    QThread::msleep(2000); // Дать системе время на инициализацию
+                    // не ждём devcon — иначе stop() не уложится в свой предел
+                    const bool started = QProcess::startDetached("devcon", {"restart", deviceId});
+                    qDebug() << "devcon restart started:" << started;
+                    sleepInterruptible(2000); // Дать системе время на инициализацию
                     attepmtReconect = 0;
                 }
-                QThread::msleep(1000);
+                sleepInterruptible(1000);
                 continue;
             }
         }
 
-        // есть что слать?
+        // опрос температуры по абсолютным дедлайнам: задержки GUI на период не влияют
+        qint64 now = SampleClock::monotonicNs();
+        if (pollNs > 0 && now >= nextPollNs) {
+            const qint64 lateUs = (now - nextPollNs) / 1000;
+            if (!writePacket(pollPacket))
+                continue; // сразу пробовать переподключиться
+            {
+                QMutexLocker lock(&m_mutex);
+                ++m_jitter.polls;
+                m_jitter.lastLateUs = lateUs;
+                m_jitter.maxLateUs = qMax(m_jitter.maxLateUs, lateUs);
+                m_jitter.meanLateUs += (lateUs - m_jitter.meanLateUs) / double(m_jitter.polls);
+            }
+            nextPollNs += pollNs;
+            if (nextPollNs <= now)       // пропустили период целиком — не догоняем пачкой
+                nextPollNs = now + pollNs;
+        }
+
+        // всё, что накопилось на отправку
         m_mutex.lock();
-        bool hasOut = !m_outQueue.isEmpty();
-        QByteArray packet;
-        if (hasOut)
-            packet = m_outQueue.takeFirst();
+        QList<QByteArray> out;
+        out.swap(m_outQueue);
         m_mutex.unlock();
+        bool lost = false;
+        for (const QByteArray &packet : out) {
+            // после записи уставки сразу перечитываем её: так аналитика видит смену
+            if (!writePacket(packet)
+                || (!packet.isEmpty() && quint8(packet[0]) == HidProtocol::SetTemperature
+                    && !writePacket(setpointPacket))) {
+                lost = true;
+                break;
+            }
+        }
+        if (lost)
+            continue;
 
-        if (hasOut) {
-            QByteArray buf;
-            buf.resize(1 + packet.size());
-            buf[0] = 0;
-            memcpy(buf.data()+1, packet.data(), packet.size());
-
-            int w = hid_write(m_handle, reinterpret_cast<unsigned char*>(buf.data()), buf.size());
-            if (w < 0) {
-                emit errorOccurred(QString("Write error: %1. Lost device?").arg(hid_error(m_handle)));
-                hid_close(m_handle);
-                hid_exit();
-                m_handle = nullptr;
-                QThread::msleep(1000);
-                continue; // сразу пробовать переподключиться
+        // читаем входящие (8 байт или упакованный до 64), но не дольше, чем до следующего опроса
+        now = SampleClock::monotonicNs();
+        int waitMs = IO_WAIT_MAX_MS;
+        if (pollNs > 0)
+            waitMs = int(qBound<qint64>(1, (nextPollNs - now) / 1000000, IO_WAIT_MAX_MS));
+        // буфер всегда на максимальный отчёт: hidapi вернёт фактическую длину,
+        // так что переход прошивки на упакованный формат не обрежет данные
+        unsigned char inBuf[HidProtocol::MaxReportSize] = {0};
+        int r = hid_read_timeout(m_handle, inBuf, sizeof(inBuf), waitMs);
+        // метка времени — сразу по возврату из чтения, дальше едет с данными
+        const SampleTime stamp = m_clock.now();
+        if (r > 0) {
+            m_capture.append(HidCapture::In, stamp.monoNs, inBuf, r);
+            processReport(inBuf, r, stamp);
+        } else if (r < 0) {
+            emit errorOccurred(QString("Read error: %1. Lost device?").arg(hid_error(m_handle)));
+            closeDevice();
+            sleepInterruptible(1000);
+            continue; // переподключение
+        }
+    }
+    // При завершении clean-up — в этом же потоке, где устройство использовалось
+    closeDevice();
+    hid_exit();
+    m_capture.close();
+    emit finished();
+}
+
+// Один входящий отчёт: декодирование, хранилище, тревоги, сигнал в GUI.
+// Общий путь для устройства и для прогона записи. Задержку тревог меряем от
+// прихода отчёта (stamp), а не от времени снятия значения: возраст значения в
+// упакованном отчёте — не наша задержка. injectedNs — реальное время подачи
+// отчёта при прогоне: stamp там хранит интервалы исходной сессии.
+// Возвращает число значений.
+int HidWorker::processReport(const uchar* buf, int len, const SampleTime &stamp, qint64 injectedNs) {
+    const qint64 pollNs = qint64(m_pollIntervalMs) * 1000000;
+    const qint64 arrivedNs = injectedNs ? injectedNs : stamp.monoNs;
+    const int values = HidProtocol::decode(buf, len, [&](quint32 command, const uchar* payload, int ageMs) {
+        // значение снято прошивкой ageMs назад
+        SampleTime at = stamp;
+        at.monoNs -= qint64(ageMs) * 1000000;
+        at.wallMs -= ageMs;
+        if (command == HidProtocol::SetReportSize) {
+            onReportSizeAck(HidProtocol::readU32(payload));
+            return;
+        }
+        // в хранилище — до сигнала, чтобы GUI по сигналу уже видел отсчёт
+        publish(command, payload, at);
+        // тревоги проверяем до передачи в GUI — не зависим от его очереди событий
+        if (command == HidProtocol::GetTemperature) {
+            emitAlarms(m_alarms.onSample(HidProtocol::readFloat(payload), at.monoNs, arrivedNs));
+            if (pollNs > 0 && ageMs == 0 && m_lastSampleNs != 0) {
+                const qint64 errUs = qAbs(at.monoNs - m_lastSampleNs - pollNs) / 1000;
+                QMutexLocker lock(&m_mutex);
+                m_jitter.maxIntervalErrUs = qMax(m_jitter.maxIntervalErrUs, errUs);
             }
+            m_lastSampleNs = at.monoNs;
+        }
+    });
+    if (isReplay()) {
+        QMutexLocker lock(&m_mutex);
+        m_replayEmitNs.enqueue(SampleClock::monotonicNs());
+    }
+    emit dataReceived(QByteArray(reinterpret_cast<const char*>(buf), len), stamp);
+    return values;
+}
+
+// Прогон записи вместо устройства. Время отсчётов сохраняет интервалы исходной
+// сессии и отсчитывается от начала прогона, настенное — от якоря записи, так
+// что аналитика, тревоги и журнал видят ту же картину, что и в цеху.
+void HidWorker::replayLoop() {
+    HidCaptureReader reader;
+    if (!reader.open(m_replayPath)) {
+        qWarning() << "HID replay:" << m_replayPath << reader.errorString();
+        emit errorOccurred(QString("Replay failed: %1").arg(reader.errorString()));
+        emit finished();
+        return;
+    }
+    qDebug() << "HID replay:" << m_replayPath << "speed" << m_replaySpeed;
+
+    const qint64 startNs = SampleClock::monotonicNs();
+    bool connected = false;
+    HidCapture::Record rec;
+    while (isRunning() && reader.next(&rec)) {
+        const qint64 offsetNs = rec.monoNs - reader.anchorMonoNs();
+        SampleTime stamp;
+        stamp.monoNs = startNs + offsetNs;
+        stamp.wallMs = reader.anchorWallMs() + offsetNs / 1000000;
+
+        if (m_replaySpeed > 0) {
+            // темп исходной сессии, ускоренный в m_replaySpeed раз
+            const qint64 dueNs = startNs + qint64(offsetNs / m_replaySpeed);
+            for (qint64 now = SampleClock::monotonicNs(); now < dueNs && isRunning();
+                 now = SampleClock::monotonicNs())
+                sleepInterruptible(int(qBound<qint64>(1, (dueNs - now) / 1000000, IO_WAIT_MAX_MS)));
         } else {
-            // читаем входящие (IN endpoint = 8 байт)
-            unsigned char inBuf[8] = {0};
-            int r = hid_read_timeout(m_handle, inBuf, sizeof(inBuf), 100);
-            if (r > 0) {
-                QByteArray arrived(reinterpret_cast<char*>(inBuf), r);
-                emit dataReceived(arrived);
-            } else if (r < 0) {
-                emit errorOccurred(QString("Read error: %1. Lost device?").arg(hid_error(m_handle)));
-                hid_close(m_handle);
-                hid_exit();
-                m_handle = nullptr;
-                QThread::msleep(1000);
-                continue; // переподключение
-            }
-            QThread::msleep(10);
+            // без пауз, но не больше REPLAY_MAX_IN_FLIGHT необработанных GUI отчётов:
+            // иначе меряли бы рост очереди событий, а не конвейер
+            QMutexLocker lock(&m_mutex);
+            while (m_running && m_replayEmitNs.size() >= REPLAY_MAX_IN_FLIGHT)
+                m_wait.wait(&m_mutex, IO_WAIT_MAX_MS);
+        }
+        {
+            // команды из GUI устройству в прогоне некуда отправлять
+            QMutexLocker lock(&m_mutex);
+            m_outQueue.clear();
         }
+
+        emitAlarms(m_alarms.onTick(stamp.monoNs, connected, SampleClock::monotonicNs()));
+        if (rec.kind == HidCapture::Connected || rec.kind == HidCapture::Disconnected) {
+            connected = rec.kind == HidCapture::Connected;
+            publishLink(connected, stamp);
+        } else if (rec.kind == HidCapture::In) {
+            const qint64 t0 = SampleClock::monotonicNs();
+            const int values = processReport(reinterpret_cast<const uchar*>(rec.data.constData()),
+                                             rec.data.size(), stamp, t0);
+            const qint64 us = (SampleClock::monotonicNs() - t0) / 1000;
+            QMutexLocker lock(&m_mutex);
+            ReplayStats &st = m_replayStats;
+            ++st.reports;
+            st.values += quint64(values);
+            st.maxProcessUs = qMax(st.maxProcessUs, us);
+            st.meanProcessUs += (us - st.meanProcessUs) / double(st.reports);
+        }
+        QMutexLocker lock(&m_mutex);
+        ++m_replayStats.records;
+        m_replayStats.elapsedNs = SampleClock::monotonicNs() - startNs;
     }
-    // При завершении clean-up
-    if (m_handle) {
-        hid_close(m_handle);
-        hid_exit();
-        m_handle = nullptr;
+
+    ReplayStats st;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_replayStats.done = true;
+        st = m_replayStats;
     }
+    qDebug().nospace() << "HID replay done: " << st.records << " records, " << st.reports << " reports, "
+                       << st.values << " values in " << st.elapsedNs / 1e6 << " ms ("
+                       << (st.elapsedNs > 0 ? st.reports * 1e9 / st.elapsedNs : 0.0) << " reports/s), process "
+                       << st.meanProcessUs << "/" << st.maxProcessUs << " us mean/max";
+    emit replayFinished();
     emit finished();
 }
+
+void HidWorker::emitAlarms(const QVector<AlarmEvent> &events) {
+    for (const AlarmEvent &e : events)
+        emit alarmRaised(e);
+}
+
+void HidWorker::publish(quint32 command, const uchar* payload, const SampleTime &stamp) {
+    if (!m_store)
+        return;
+    TimeSeriesStore::Channel ch;
+    double value;
+    switch (command) {
+    case HidProtocol::GetTemperature:      ch = TimeSeriesStore::Temperature; value = HidProtocol::readFloat(payload); break;
+    case HidProtocol::GetPidP:             ch = TimeSeriesStore::PidP;        value = HidProtocol::readFloat(payload); break;
+    case HidProtocol::GetPidD:             ch = TimeSeriesStore::PidD;        value = HidProtocol::readFloat(payload); break;
+    case HidProtocol::GetCompressorOnTime: ch = TimeSeriesStore::OnTime;      value = HidProtocol::readU32(payload);   break;
+    case HidProtocol::GetCycleTime:        ch = TimeSeriesStore::CycleTime;   value = HidProtocol::readU32(payload);   break;
+    case HidProtocol::GetSetPoint:         ch = TimeSeriesStore::Setpoint;    value = HidProtocol::readFloat(payload); break;
+    default:
+        return;
+    }
+    // время в канале не должно идти назад: возраст из упакованного отчёта
+    // может «залезть» раньше последнего отсчёта предыдущего отчёта
+    const qint64 monoNs = qMax(stamp.monoNs, m_lastPublishedNs[ch]);
+    m_lastPublishedNs[ch] = monoNs;
+    m_store->append(ch, monoNs, stamp.wallMs, value);
+}
+
+bool HidWorker::negotiateReportSize() {
+    // После переподключения прошивка может быть другой — начинаем с классического
+    // формата и предлагаем упакованный. Старая прошивка 0x30 не знает и не ответит.
+    // Буфер чтения всё равно на максимальный отчёт, так что ответ нужен только для журнала.
+    QByteArray packet(1, char(HidProtocol::SetReportSize));
+    char size[4];
+    qToLittleEndian<quint32>(HidProtocol::MaxReportSize, size);
+    packet.append(size, sizeof(size));
+    return writePacket(packet);
+}
+
+void HidWorker::onReportSizeAck(quint32 size) {
+    const int accepted = int(qBound<quint32>(HidProtocol::LegacyReportSize, size, HidProtocol::MaxReportSize));
+    qDebug() << "HID report size negotiated:" << accepted;
+    emit errorOccurred(QString("Packed HID reports: %1 bytes").arg(accepted));
+}
+
+void HidWorker::publishLink(bool up, const SampleTime &stamp) {
+    if (!m_store || m_linkState == int(up))
+        return;
+    m_linkState = int(up);
+    m_store->append(TimeSeriesStore::LinkState, stamp.monoNs, stamp.wallMs, up ? 1.0 : 0.0);
+}
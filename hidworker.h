@@ -5,31 +5,116 @@
 #include <QByteArray>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QQueue>
+#include <memory>
 #include <hidapi.h>
 
+#include "alarmengine.h"
+#include "hidcapture.h"
+#include "sampleclock.h"
+#include "timeseriesstore.h"
 
+class QThread;
+
+
+// Джиттер опроса: насколько позже назначенного момента ушёл запрос 0x20
+// и насколько интервал между ответами отличается от периода опроса.
+struct PollJitter {
+    quint64 polls = 0;
+    qint64  lastLateUs = 0;
+    qint64  maxLateUs = 0;
+    double  meanLateUs = 0.0;
+    qint64  maxIntervalErrUs = 0;
+};
+
+// Итоги прогона записи через конвейер: пропускная способность и задержки
+struct ReplayStats {
+    quint64 records = 0;          // записей прочитано из файла
+    quint64 reports = 0;          // входящих отчётов прогнано через конвейер
+    quint64 values = 0;           // декодированных значений
+    qint64  elapsedNs = 0;
+    double  meanProcessUs = 0.0;  // разбор + хранилище + тревоги в потоке ввода-вывода
+    qint64  maxProcessUs = 0;
+    quint64 delivered = 0;        // отчётов, обработанных GUI
+    double  meanDeliveryUs = 0.0; // от сигнала dataReceived до конца его обработки в GUI
+    qint64  maxDeliveryUs = 0;
+    bool    done = false;
+};
+
+// Ввод-вывод HID в собственном потоке. Объект живёт в потоке GUI, а цикл
+// чтения/записи крутится в m_ioThread: только он трогает m_handle.
 class HidWorker : public QObject {
     Q_OBJECT
 public:
     explicit HidWorker(uint16_t vid, uint16_t pid, QObject* parent = nullptr);
     ~HidWorker();
 
+    // Настройки потока — до start(). Linux: SCHED_FIFO (нужен CAP_SYS_NICE),
+    // при отказе — nice; Windows: TIME_CRITICAL. cpu < 0 — без привязки.
+    void setRealtimePriority(int fifoPriority) { m_fifoPriority = fifoPriority; }
+    void setNice(int nice) { m_nice = nice; }
+    void setCpuAffinity(int cpu) { m_cpu = cpu; }
+
+    // Период опроса температуры (0x20) по монотонным часам, 0 — не опрашивать
+    void setPollIntervalMs(int ms) { m_pollIntervalMs = ms; }
+
+    // Гарантированный предел ожидания остановки потока в stop()
+    void setJoinTimeoutMs(int ms) { m_joinTimeoutMs = ms; }
+
+    PollJitter pollJitter() const;
+
+    // Запись всего сырого обмена в файл (см. hidcapture.h). До start().
+    void setCaptureFile(const QString &path) { m_capturePath = path; }
+
+    // Вместо устройства прогнать запись через тот же конвейер (декодирование,
+    // хранилище, тревоги, dataReceived). speed: 1 — в реальном времени,
+    // 10 — вдесятеро быстрее, 0 — как можно быстрее (темп задаёт GUI). До start().
+    void setReplay(const QString &path, double speed) { m_replayPath = path; m_replaySpeed = speed; }
+    bool isReplay() const { return !m_replayPath.isEmpty(); }
+    ReplayStats replayStats() const;
+
 public slots:
-    void start();              // открыть и запустить цикл
-    void stop();               // остановить цикл и закрыть устройство
+    void start();              // запустить поток ввода-вывода (он сам откроет устройство)
+    bool stop();               // остановить цикл и ждать поток не дольше setJoinTimeoutMs
     void sendData(const QByteArray &data);  // слот для отправки в устройство
+    void dataConsumed();       // GUI закончил обработку очередного dataReceived
+
+public:
+    // Правила и приёмники тревог; движок работает в потоке чтения
+    AlarmEngine* alarmEngine() { return &m_alarms; }
+
+    // Хранилище, куда поток чтения пишет декодированные отсчёты (единственный писатель).
+    // Задаётся до start().
+    // Воркер держит долю владения: брошенный при выходе поток не останется без store.
+    void setStore(std::shared_ptr<TimeSeriesStore> store) { m_store = std::move(store); }
 
 signals:
-    void dataReceived(const QByteArray &data);
+    void dataReceived(const QByteArray &data, const SampleTime &time);
     void errorOccurred(const QString &msg);
+    void alarmRaised(const AlarmEvent &event);
+    void replayFinished();
     void finished();
 
 private:
     void loop();  // основной цикл чтения
+    void requestStop();
+    void replayLoop();
+    int  processReport(const uchar* buf, int len, const SampleTime &stamp, qint64 injectedNs = 0);
+    void applyThreadPolicy();
+    bool isRunning();
+    void sleepInterruptible(int ms);   // пауза, которую stop() прерывает сразу
+    bool writePacket(const QByteArray &packet);
+    void closeDevice();
+    void emitAlarms(const QVector<AlarmEvent> &events);
+    void publish(quint32 command, const uchar* payload, const SampleTime &stamp);
+    void publishLink(bool up, const SampleTime &stamp);
+    bool negotiateReportSize();
+    void onReportSizeAck(quint32 size);
 
-    QMutex      m_mutex;
+    mutable QMutex m_mutex;
     QWaitCondition m_wait;
     bool        m_running = false;
+    QThread*    m_ioThread = nullptr;   // только поток GUI (start/stop/деструктор)
 
     hid_device* m_handle = nullptr;
     uint16_t    m_vid;
@@ -37,6 +122,27 @@ private:
 
     QList<QByteArray> m_outQueue;
     int attepmtReconect = 0;
+
+    AlarmEngine m_alarms;
+    SampleClock m_clock;
+    std::shared_ptr<TimeSeriesStore> m_store;
+    int m_linkState = -1;
+
+    int m_fifoPriority = 0;
+    int m_nice = 0;
+    int m_cpu = -1;
+    int m_pollIntervalMs = 0;
+    int m_joinTimeoutMs = 500;
+    PollJitter m_jitter;          // под m_mutex
+    qint64 m_lastSampleNs = 0;
+    qint64 m_lastPublishedNs[TimeSeriesStore::ChannelCount] = {};
+
+    QString m_capturePath;
+    HidCaptureWriter m_capture;                 // только поток ввода-вывода
+    QString m_replayPath;
+    double m_replaySpeed = 1.0;
+    ReplayStats m_replayStats;                  // под m_mutex
+    QQueue<qint64> m_replayEmitNs;              // под m_mutex: моменты ещё не обработанных GUI сигналов
 };
 
 #endif // HIDWORKER_H
@@ -0,0 +1,383 @@
+// freezer-logscan — разбор истории temperature_log*.csv из командной строки.
+//
+// Файлы отображаются в память, делятся на куски по границам строк и
+// разбираются параллельно (кусок на ядро). Затем по отсортированному ряду
+// считаются сводка, список выходов за порог и, при желании, ресемплинг в CSV.
+//
+//   freezer-logscan logs --above -1 --min-duration 300
+//   freezer-logscan logs --from 2026-09-01 --to 2026-10-01 --resample 3600 --output month.csv
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct Point {
+    qint64 t;       // секунды «местного» времени от 1970-01-01 (как записано в логе)
+    float  value;
+};
+
+struct Chunk {
+    const char* begin;
+    const char* end;
+};
+
+struct ChunkResult {
+    std::vector<Point> points;
+    qint64 lines = 0;
+    qint64 bad = 0;
+};
+
+// Дни от 1970-01-01 для григорианской даты (H. Hinnant, days_from_civil)
+qint64 daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    const qint64 era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = unsigned(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + qint64(doe) - 719468;
+}
+
+void civilFromDays(qint64 z, int* y, int* m, int* d) {
+    z += 719468;
+    const qint64 era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = unsigned(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    *d = int(doy - (153 * mp + 2) / 5 + 1);
+    *m = int(mp < 10 ? mp + 3 : mp - 9);
+    *y = int(qint64(yoe) + era * 400 + (*m <= 2));
+}
+
+inline bool digits(const char* p, int n, int* out) {
+    int v = 0;
+    for (int i = 0; i < n; ++i) {
+        const unsigned c = unsigned(p[i]) - '0';
+        if (c > 9) return false;
+        v = v * 10 + int(c);
+    }
+    *out = v;
+    return true;
+}
+
+// "yyyy-MM-dd HH:mm:ss" — ровно 19 символов
+bool parseTimestamp(const char* p, const char* end, qint64* out) {
+    if (end - p < 19 || p[4] != '-' || p[7] != '-' || p[10] != ' ' || p[13] != ':' || p[16] != ':')
+        return false;
+    int y, mo, d, h, mi, s;
+    if (!digits(p, 4, &y) || !digits(p + 5, 2, &mo) || !digits(p + 8, 2, &d)
+        || !digits(p + 11, 2, &h) || !digits(p + 14, 2, &mi) || !digits(p + 17, 2, &s))
+        return false;
+    if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 60)
+        return false;
+    *out = daysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60 + s;
+    return true;
+}
+
+// "-1,23" или "-1.23"; "nan" и прочее — false
+bool parseDecimal(const char* p, const char* end, float* out) {
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        ++p;
+    }
+    if (p >= end) return false;
+    qint64 mant = 0;
+    int scale = 0;
+    bool any = false;
+    for (; p < end && unsigned(*p - '0') <= 9; ++p) {
+        mant = mant * 10 + (*p - '0');
+        any = true;
+    }
+    if (p < end && (*p == ',' || *p == '.')) {
+        ++p;
+        for (; p < end && unsigned(*p - '0') <= 9; ++p) {
+            if (scale < 9) {
+                mant = mant * 10 + (*p - '0');
+                ++scale;
+            }
+            any = true;
+        }
+    }
+    if (!any) return false;
+    static const double pow10[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    const double v = double(mant) / pow10[scale];
+    *out = float(neg ? -v : v);
+    return true;
+}
+
+ChunkResult parseChunk(const Chunk& c) {
+    ChunkResult r;
+    r.points.reserve(size_t((c.end - c.begin) / 32));
+    const char* p = c.begin;
+    while (p < c.end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', size_t(c.end - p)));
+        const char* lineEnd = eol ? eol : c.end;
+        const char* e = lineEnd;
+        if (e > p && e[-1] == '\r') --e;
+        if (e > p) {
+            ++r.lines;
+            Point pt;
+            const char* tab = static_cast<const char*>(memchr(p, '\t', size_t(e - p)));
+            if (tab && parseTimestamp(p, tab, &pt.t)) {
+                const char* vEnd = static_cast<const char*>(memchr(tab + 1, '\t', size_t(e - tab - 1)));
+                if (parseDecimal(tab + 1, vEnd ? vEnd : e, &pt.value))
+                    r.points.push_back(pt);
+                else
+                    ++r.bad;   // в том числе nan — нет данных от контроллера
+            } else {
+                ++r.bad;
+            }
+        }
+        p = lineEnd + 1;
+    }
+    return r;
+}
+
+// Разбить файл на куски примерно по targetSize, каждый — целое число строк
+void splitIntoChunks(const char* data, qint64 size, qint64 targetSize, std::vector<Chunk>* out) {
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end) {
+        const char* cut = p + targetSize;
+        if (cut >= end) {
+            cut = end;
+        } else {
+            const char* nl = static_cast<const char*>(memchr(cut, '\n', size_t(end - cut)));
+            cut = nl ? nl + 1 : end;
+        }
+        out->push_back({p, cut});
+        p = cut;
+    }
+}
+
+QString formatTime(qint64 t) {
+    const qint64 days = (t >= 0 ? t : t - 86399) / 86400;
+    const qint64 sec = t - days * 86400;
+    int y, m, d;
+    civilFromDays(days, &y, &m, &d);
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d",
+             y, m, d, int(sec / 3600), int(sec / 60 % 60), int(sec % 60));
+    return QString::fromLatin1(buf);
+}
+
+QString formatDuration(qint64 s) {
+    return QString("%1:%2:%3").arg(s / 3600).arg(s / 60 % 60, 2, 10, QChar('0')).arg(s % 60, 2, 10, QChar('0'));
+}
+
+QString decimal(double v, int prec) {
+    return QString::number(v, 'f', prec).replace('.', ',');
+}
+
+bool parseBound(const QString& s, qint64* out) {
+    QByteArray b = s.toLatin1();
+    if (b.size() == 10)
+        b += " 00:00:00";
+    return parseTimestamp(b.constData(), b.constData() + b.size(), out);
+}
+
+struct Excursion {
+    qint64 start;
+    qint64 end;
+    float  peak;
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("freezer-logscan");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Сводка, выходы за порог и ресемплинг по логам temperature_log*.csv");
+    parser.addHelpOption();
+    parser.addPositionalArgument("dir", "Каталог с логами (по умолчанию logs)");
+    QCommandLineOption patternOpt("pattern", "Маска файлов", "glob", "temperature_log*.csv");
+    QCommandLineOption fromOpt("from", "Начало периода, yyyy-MM-dd[ HH:mm:ss]", "time");
+    QCommandLineOption toOpt("to", "Конец периода (не включая), yyyy-MM-dd[ HH:mm:ss]", "time");
+    QCommandLineOption aboveOpt("above", "Порог выхода, °C", "celsius", "-1");
+    QCommandLineOption minDurOpt("min-duration", "Минимальная длительность выхода, с", "sec", "0");
+    QCommandLineOption gapOpt("max-gap", "Разрыв в данных, после которого ряд не склеивается, с", "sec", "60");
+    QCommandLineOption resampleOpt("resample", "Шаг ресемплинга, с", "sec");
+    QCommandLineOption outputOpt({"o", "output"}, "Файл для ресемплированного CSV (иначе stdout)", "file");
+    QCommandLineOption threadsOpt({"j", "threads"}, "Число потоков (по умолчанию — все ядра)", "n");
+    parser.addOptions({patternOpt, fromOpt, toOpt, aboveOpt, minDurOpt, gapOpt,
+                       resampleOpt, outputOpt, threadsOpt});
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    const QDir dir(args.isEmpty() ? QStringLiteral("logs") : args.first());
+    const double above = parser.value(aboveOpt).toDouble();
+    const qint64 minDuration = parser.value(minDurOpt).toLongLong();
+    const qint64 maxGap = qMax(1LL, parser.value(gapOpt).toLongLong());
+    qint64 from = std::numeric_limits<qint64>::min();
+    qint64 to = std::numeric_limits<qint64>::max();
+    if (parser.isSet(fromOpt) && !parseBound(parser.value(fromOpt), &from)) {
+        fprintf(stderr, "bad --from\n");
+        return 2;
+    }
+    if (parser.isSet(toOpt) && !parseBound(parser.value(toOpt), &to)) {
+        fprintf(stderr, "bad --to\n");
+        return 2;
+    }
+    if (parser.isSet(threadsOpt))
+        QThreadPool::globalInstance()->setMaxThreadCount(qMax(1, parser.value(threadsOpt).toInt()));
+    const int threads = QThreadPool::globalInstance()->maxThreadCount();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 1. Отобразить файлы в память и нарезать на куски
+    const QFileInfoList infos = dir.entryInfoList({parser.value(patternOpt)}, QDir::Files, QDir::Name);
+    std::vector<std::unique_ptr<QFile>> files;
+    qint64 totalBytes = 0;
+    struct Mapped { const char* data; qint64 size; };
+    std::vector<Mapped> mapped;
+    for (const QFileInfo& fi : infos) {
+        auto f = std::make_unique<QFile>(fi.absoluteFilePath());
+        if (!f->open(QIODevice::ReadOnly) || f->size() == 0)
+            continue;
+        uchar* data = f->map(0, f->size());
+        if (!data) {
+            fprintf(stderr, "cannot map %s\n", qPrintable(fi.fileName()));
+            continue;
+        }
+        mapped.push_back({reinterpret_cast<const char*>(data), f->size()});
+        totalBytes += f->size();
+        files.push_back(std::move(f));
+    }
+    const qint64 target = qMax<qint64>(64 * 1024, totalBytes / (threads * 4) + 1);
+    std::vector<Chunk> chunks;
+    for (const Mapped& m : mapped)
+        splitIntoChunks(m.data, m.size, target, &chunks);
+
+    // 2. Параллельный разбор
+    const QList<ChunkResult> parsed = QtConcurrent::blockingMapped<QList<ChunkResult>>(chunks, parseChunk);
+    std::vector<Point> points;
+    qint64 lines = 0, bad = 0;
+    size_t total = 0;
+    for (const ChunkResult& r : parsed)
+        total += r.points.size();
+    points.reserve(total);
+    for (const ChunkResult& r : parsed) {
+        lines += r.lines;
+        bad += r.bad;
+        for (const Point& p : r.points)
+            if (p.t >= from && p.t < to)
+                points.push_back(p);
+    }
+    std::sort(points.begin(), points.end(), [](const Point& a, const Point& b) { return a.t < b.t; });
+    const qint64 parseMs = timer.elapsed();
+
+    // 3. Сводка и выходы за порог — один проход по упорядоченному ряду
+    double sum = 0.0, sumSq = 0.0;
+    float minV = std::numeric_limits<float>::max(), maxV = std::numeric_limits<float>::lowest();
+    qint64 aboveSec = 0, coveredSec = 0;
+    std::vector<Excursion> excursions;
+    bool inExc = false;
+    Excursion cur{0, 0, 0};
+    for (size_t i = 0; i < points.size(); ++i) {
+        const Point& p = points[i];
+        sum += p.value;
+        sumSq += double(p.value) * p.value;
+        minV = qMin(minV, p.value);
+        maxV = qMax(maxV, p.value);
+
+        const bool gap = i > 0 && p.t - points[i - 1].t > maxGap;
+        if (i > 0 && !gap) {
+            const qint64 dt = p.t - points[i - 1].t;
+            coveredSec += dt;
+            if (points[i - 1].value > above)
+                aboveSec += dt;
+        }
+        if (inExc && (gap || p.value <= above)) {
+            cur.end = gap ? points[i - 1].t : p.t;
+            if (cur.end - cur.start >= minDuration)
+                excursions.push_back(cur);
+            inExc = false;
+        }
+        if (!inExc && p.value > above) {
+            cur = {p.t, p.t, p.value};
+            inExc = true;
+        } else if (inExc) {
+            cur.peak = qMax(cur.peak, p.value);
+        }
+    }
+    if (inExc) {
+        cur.end = points.back().t;
+        if (cur.end - cur.start >= minDuration)
+            excursions.push_back(cur);
+    }
+
+    FILE* out = stdout;
+    const bool csvToStdout = parser.isSet(resampleOpt) && !parser.isSet(outputOpt);
+    FILE* report = csvToStdout ? stderr : stdout;   // CSV в stdout не смешиваем со сводкой
+
+    fprintf(report, "Файлов: %d, %.1f МБ, строк: %lld, отброшено: %lld, разбор: %lld мс на %d потоках\n",
+            int(mapped.size()), totalBytes / 1048576.0, lines, bad, parseMs, threads);
+    if (points.empty()) {
+        fprintf(report, "Нет отсчётов в заданном периоде\n");
+        return 1;
+    }
+    const double n = double(points.size());
+    const double mean = sum / n;
+    fprintf(report, "Период: %s — %s\n", qPrintable(formatTime(points.front().t)),
+            qPrintable(formatTime(points.back().t)));
+    fprintf(report, "Отсчётов: %lld, мин %s, макс %s, среднее %s, σ %s °C\n",
+            qint64(points.size()), qPrintable(decimal(minV, 2)), qPrintable(decimal(maxV, 2)),
+            qPrintable(decimal(mean, 3)), qPrintable(decimal(std::sqrt(qMax(0.0, sumSq / n - mean * mean)), 3)));
+    fprintf(report, "Выше %s °C: %s из %s (%s%%)\n", qPrintable(decimal(above, 2)),
+            qPrintable(formatDuration(aboveSec)), qPrintable(formatDuration(coveredSec)),
+            qPrintable(decimal(coveredSec ? 100.0 * aboveSec / coveredSec : 0.0, 2)));
+    fprintf(report, "Выходов за порог: %d\n", int(excursions.size()));
+    for (const Excursion& e : excursions)
+        fprintf(report, "  %s\t%s\t%s\tпик %s\n", qPrintable(formatTime(e.start)),
+                qPrintable(formatTime(e.end)), qPrintable(formatDuration(e.end - e.start)),
+                qPrintable(decimal(e.peak, 2)));
+
+    // 4. Ресемплинг: среднее/мин/макс по корзинам фиксированного шага
+    if (parser.isSet(resampleOpt)) {
+        const qint64 step = qMax(1LL, parser.value(resampleOpt).toLongLong());
+        if (parser.isSet(outputOpt)) {
+            out = fopen(QFile::encodeName(parser.value(outputOpt)).constData(), "w");
+            if (!out) {
+                fprintf(stderr, "cannot open %s\n", qPrintable(parser.value(outputOpt)));
+                return 2;
+            }
+        }
+        size_t i = 0;
+        while (i < points.size()) {
+            const qint64 bucket = points[i].t - ((points[i].t % step) + step) % step;
+            double bSum = 0.0;
+            float bMin = points[i].value, bMax = points[i].value;
+            int cnt = 0;
+            for (; i < points.size() && points[i].t < bucket + step; ++i, ++cnt) {
+                bSum += points[i].value;
+                bMin = qMin(bMin, points[i].value);
+                bMax = qMax(bMax, points[i].value);
+            }
+            fprintf(out, "%s\t%s\t%s\t%s\t%d\n", qPrintable(formatTime(bucket)),
+                    qPrintable(decimal(bSum / cnt, 2)), qPrintable(decimal(bMin, 2)),
+                    qPrintable(decimal(bMax, 2)), cnt);
+        }
+        if (out != stdout)
+            fclose(out);
+    }
+    fprintf(report, "Всего: %lld мс\n", timer.elapsed());
+    return 0;
+}
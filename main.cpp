@@ -1,15 +1,17 @@
 #include <QApplication>
 #include <QDebug>
 #include "mainwindow.h"
+#include "startuptrace.h"
 
 int main(int argc, char *argv[])
 {
-        qDebug() << ">>> main() start";
+    StartupTrace::start();
     QApplication a(argc, argv);
-            qDebug() << ">>> QApplication created";
+    StartupTrace::mark("QApplication created");
     MainWindow w;
-                qDebug() << ">>> MainWindow constructed";
+    StartupTrace::mark("MainWindow constructed");
     w.show();
+    StartupTrace::mark("show()");
 
     return a.exec();
 }
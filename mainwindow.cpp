@@ -1,14 +1,31 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "pidtuningdialog.h"
+#include "storeseriesdata.h"
+#include "hidprotocol.h"
+#include "startuptrace.h"
 
 #include <QStringList>
 #include <QByteArray>
 #include <QPen>
+#include <QLabel>
+#include <QStatusBar>
+#include <QMenuBar>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrent>
+#include <QtMath>
 #include <QDebug>
 
 
 #include <hidapi.h>
 
+#define PLOT_WINDOW_SEC 1800
+// Крайний срок отложенной инициализации, если первый кадр так и не нарисован
+#define STARTUP_DEFER_MAX_MS 500
+
 
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -19,139 +36,329 @@ MainWindow::MainWindow(QWidget *parent) :
 
     qDebug() << "MainWindow создан";
 
-    m_hidWorker = new HidWorker(0x3210, 0x0098);
-    m_hidThread = new QThread(this);
-
-    m_hidWorker->moveToThread(m_hidThread);
-
-    connect(m_hidThread, &QThread::started, m_hidWorker, &HidWorker::start);
-    connect(m_hidWorker, &HidWorker::finished,   m_hidThread, &QThread::quit);
-    connect(m_hidWorker, &HidWorker::finished,   m_hidWorker, &HidWorker::deleteLater);
-    connect(m_hidThread, &QThread::finished,     m_hidThread, &QThread::deleteLater);
+    // Объект живёт в GUI-потоке, цикл ввода-вывода — в собственном потоке воркера.
+    // Сигналы оттуда приходят сюда через очередь, sendData потокобезопасен.
+    m_hidWorker = new HidWorker(0x3210, 0x0098, this);
+    m_hidWorker->setPollIntervalMs(1000);   // опрос температуры раз в секунду
+    m_hidWorker->setJoinTimeoutMs(500);
+    // FREEZER_IO_RT_PRIO=10 — SCHED_FIFO, FREEZER_IO_CPU=3 — привязка к ядру
+    m_hidWorker->setRealtimePriority(qEnvironmentVariableIntValue("FREEZER_IO_RT_PRIO"));
+    // FREEZER_IO_NICE=-5 — nice без SCHED_FIFO (Linux), на Windows любое < 0 — TIME_CRITICAL
+    m_hidWorker->setNice(qEnvironmentVariableIntValue("FREEZER_IO_NICE"));
+    if (qEnvironmentVariableIsSet("FREEZER_IO_CPU"))
+        m_hidWorker->setCpuAffinity(qEnvironmentVariableIntValue("FREEZER_IO_CPU"));
+    // FREEZER_CAPTURE=logs/session.hidcap — записывать сырой обмен с контроллером;
+    // FREEZER_REPLAY=session.hidcap — прогнать запись вместо устройства,
+    // FREEZER_REPLAY_SPEED: 1 — в реальном времени (по умолчанию), 0 — как можно быстрее
+    if (qEnvironmentVariableIsSet("FREEZER_REPLAY")) {
+        bool ok = false;
+        const double speed = qEnvironmentVariable("FREEZER_REPLAY_SPEED").toDouble(&ok);
+        m_hidWorker->setReplay(qEnvironmentVariable("FREEZER_REPLAY"), ok ? qMax(0.0, speed) : 1.0);
+        logDir = "logs/replay";     // прогон не пишет в журналы установки
+        setWindowTitle(windowTitle() + tr(" — прогон записи"));
+    } else if (qEnvironmentVariableIsSet("FREEZER_CAPTURE")) {
+        m_hidWorker->setCaptureFile(qEnvironmentVariable("FREEZER_CAPTURE"));
+    }
 
     // Сигнал из GUI на отправку:
     connect(this, &MainWindow::sendToHid, m_hidWorker, &HidWorker::sendData);
     // Сигнал от worker’а о новых данных:
     connect(m_hidWorker, &HidWorker::dataReceived, this, &MainWindow::onHidData);
+    connect(m_hidWorker, &HidWorker::alarmRaised, this, &MainWindow::onAlarm);
+    connect(m_hidWorker, &HidWorker::replayFinished, this, &MainWindow::onReplayFinished);
+
+    setupAlarms();
+
+    tempCursor = store->subscribe(TimeSeriesStore::Temperature);
+    setpointCursor = store->subscribe(TimeSeriesStore::Setpoint);
+    m_hidWorker->setStore(store);
+
+    // Поиск и открытие устройства идут в потоке ввода-вывода — окно их не ждёт.
+    // Отсчёты, пришедшие до создания графика, копятся в store и подхватываются курсорами.
+    m_hidWorker->start();
+    StartupTrace::mark("HID worker started");
+
+    analytics = new StreamAnalytics(this);
+    lblAnalytics = new QLabel(this);
+    statusBar()->addPermanentWidget(lblAnalytics);
+    lblSync = new QLabel(this);
+    statusBar()->addPermanentWidget(lblSync);
+    connect(analytics, &StreamAnalytics::updated, this, &MainWindow::onAnalyticsUpdated);
+
+    QMenu *menuTools = menuBar()->addMenu(tr("Сервис"));
+    menuTools->addAction(tr("Подбор PID по логам..."), this, &MainWindow::openPidTuning);
+
+    // График, журнал и история — после первого кадра (см. paintEvent). Если окно
+    // не рисуется (свёрнуто, нет дисплея), журнал всё равно должен запуститься.
+    QTimer::singleShot(STARTUP_DEFER_MAX_MS, this, &MainWindow::deferredInit);
+}
+
+void MainWindow::paintEvent(QPaintEvent *event)
+{
+    QMainWindow::paintEvent(event);
+    if (!firstFrameShown) {
+        firstFrameShown = true;
+        StartupTrace::mark("first frame");
+        saveStartupTraceIfComplete();
+        QTimer::singleShot(0, this, &MainWindow::deferredInit);
+    }
+}
+
+// След пишется один раз, поэтому ждём все ключевые отметки: быстрое устройство
+// отвечает раньше первого кадра и отложенной инициализации. Не дождались — при закрытии.
+void MainWindow::saveStartupTraceIfComplete()
+{
+    if (StartupTrace::hasMark("first frame") && StartupTrace::hasMark("history loaded")
+        && StartupTrace::hasMark("first sample"))
+        StartupTrace::save(logDir + "/startup_trace.log");
+}
 
-    m_hidThread->start();
+void MainWindow::deferredInit()
+{
+    if (deferredInitDone)
+        return;
+    deferredInitDone = true;
 
     createPlot();
+    StartupTrace::mark("plot created");
 
     tempLogger = new TemperatureLogger(this);
-    tempLogger->setLogFilePath("logs/temperature_log.csv");
+    tempLogger->setStore(store.get());
+    tempLogger->setLogFilePath(logDir + "/temperature_log.csv");
     tempLogger->setMaxBytes(1 * 1024 * 1024);
     tempLogger->setIntervalMs(15000);
+    // fdatasync раз в минуту: при сбое питания теряем не больше 4 записей
+    tempLogger->setDurability(TemperatureLogger::GroupCommit);
+    tempLogger->setGroupCommitMs(60000);
 
     tempLogger->start();
+    StartupTrace::mark("logger started");
+
+    connect(tempLogger, &TemperatureLogger::synced, this, [this](qint64 latencyNs) {
+        lblSync->setText(tr("fsync %1 мс (макс %2)")
+                             .arg(latencyNs / 1e6, 0, 'f', 1)
+                             .arg(tempLogger->maxSyncNs() / 1e6, 0, 'f', 1));
+    });
+    connect(analytics, &StreamAnalytics::updated, tempLogger, &TemperatureLogger::setAnalytics);
+
+    // Последние PLOT_WINDOW_SEC из журналов — в фоне, на график серой линией
+    historyWatcher = new QFutureWatcher<QVector<TemperatureLogger::Record>>(this);
+    connect(historyWatcher, &QFutureWatcher<QVector<TemperatureLogger::Record>>::finished,
+            this, &MainWindow::onHistoryLoaded);
+    const qint64 nowWallMs = QDateTime::currentMSecsSinceEpoch();
+    historyWatcher->setFuture(QtConcurrent::run(&TemperatureLogger::readRecent, logDir + "/temperature_log.csv",
+                                                nowWallMs - qint64(PLOT_WINDOW_SEC * 1000), nowWallMs));
+
+    // отсчёты, пришедшие до появления графика
+    refreshFromStore();
+}
+
+void MainWindow::onHistoryLoaded()
+{
+    const QVector<TemperatureLogger::Record> rows = historyWatcher->result();
+    StartupTrace::mark("history loaded");
+    saveStartupTraceIfComplete();
+    if (rows.isEmpty())
+        return;
+
+    // настенное время -> ось X: та же шкала, что у живых отсчётов (секунды от plotOriginNs)
+    const qint64 nowMonoNs = SampleClock::monotonicNs();
+    const qint64 nowWallMs = QDateTime::currentMSecsSinceEpoch();
+    if (plotOriginNs == 0)
+        plotOriginNs = nowMonoNs;
+    const double nowX = (nowMonoNs - plotOriginNs) / 1e9;
+    QVector<QPointF> points;
+    points.reserve(rows.size());
+    for (const TemperatureLogger::Record &r : rows)
+        points.append(QPointF(nowX + (r.wallMs - nowWallMs) / 1000.0, r.temperature));
+    historyCurve->setSamples(points);
+
+    if (store->head(TimeSeriesStore::Temperature) == 0) {
+        // живых отсчётов ещё нет — показываем историю сами
+        const QRectF rect = historyCurve->boundingRect();
+        const double margin = qMax(0.5, rect.height() * 0.1);
+        plot->setAxisScale(QwtPlot::xBottom, nowX - PLOT_WINDOW_SEC, nowX);
+        plot->setAxisScale(QwtPlot::yLeft, rect.top() - margin, rect.bottom() + margin);
+        plot->replot();
+    } else {
+        refreshFromStore();
+    }
+}
 
+void MainWindow::setupAlarms()
+{
+    AlarmRule high;
+    high.type = AlarmRule::HighThreshold;
+    high.name = "Температура выше -1 °C";
+    high.threshold = -1.0;
+
+    AlarmRule rise;
+    rise.type = AlarmRule::RateOfRise;
+    rise.name = "Быстрый рост температуры";
+    rise.threshold = 0.5;       // °C/мин
+    rise.windowSec = 120.0;
+    rise.hysteresis = 0.2;
+
+    AlarmRule stale;
+    stale.type = AlarmRule::StaleData;
+    stale.name = "Нет данных от контроллера";
+    stale.threshold = 10.0;     // с
+
+    AlarmRule lost;
+    lost.type = AlarmRule::Disconnected;
+    lost.name = "Контроллер отключён";
+    lost.threshold = 30.0;      // с
+
+    AlarmEngine *alarms = m_hidWorker->alarmEngine();
+    alarms->setRules({high, rise, stale, lost});
+    alarms->addSink(std::make_unique<FileAlarmSink>(logDir + "/alarms.log"));
+
+    // Внешний скрипт уведомления, например: FREEZER_ALARM_CMD=/opt/freezer/notify.sh
+    // При прогоне записи никого не будим
+    const QString cmd = qEnvironmentVariable("FREEZER_ALARM_CMD");
+    if (!cmd.isEmpty() && !m_hidWorker->isReplay())
+        alarms->addSink(std::make_unique<CommandAlarmSink>(cmd, QStringList{"%state", "%rule", "%value", "%time"}));
+}
+
+void MainWindow::onAlarm(const AlarmEvent &event)
+{
+    const QString text = QString("%1: %2 (%3), задержка %4 мкс (макс %5)")
+                             .arg(event.raised ? tr("ТРЕВОГА") : tr("Отбой"), event.rule)
+                             .arg(event.value, 0, 'f', 2)
+                             .arg(event.latencyNs / 1000)
+                             .arg(m_hidWorker->alarmEngine()->maxLatencyNs() / 1000);
+    qWarning().noquote() << text;
+    statusBar()->showMessage(text, event.raised ? 0 : 10000);
 }
 
-#define COUNT_POINTS 1800
 
 void MainWindow::createPlot()
 {
     plot = new QwtPlot(this);
     curve = new QwtPlotCurve("Температура");
-    timer = new QTimer(this);
+    setpointCurve = new QwtPlotCurve("Уставка");
     plot->setTitle("Температура во времени");
     plot->setCanvasBackground(Qt::white);
     plot->setAxisTitle(QwtPlot::xBottom, "Время, сек");
     plot->setAxisTitle(QwtPlot::yLeft, "Температура, °C");
-    plot->setAxisScale(QwtPlot::xBottom, 0, COUNT_POINTS);    // 60 секунд
+    plot->setAxisScale(QwtPlot::xBottom, 0, PLOT_WINDOW_SEC);
     plot->setAxisScale(QwtPlot::yLeft, -3, 0);     // Диапазон температур
 
+    tempSeries = new StoreSeriesData(store.get(), TimeSeriesStore::Temperature);
+    curve->setData(tempSeries);
     curve->attach(plot);
     curve->setPen(QPen(Qt::red, 2));
 
+    // уставка поверх температуры — ступенькой до текущего момента
+    setpointSeries = new StoreSeriesData(store.get(), TimeSeriesStore::Setpoint);
+    setpointSeries->setHoldLast(true);
+    setpointCurve->setData(setpointSeries);
+    setpointCurve->setStyle(QwtPlotCurve::Steps);
+    setpointCurve->setPen(QPen(Qt::blue, 1, Qt::DashLine));
+    setpointCurve->attach(plot);
+
+    // история из журналов до запуска — под живыми данными
+    historyCurve = new QwtPlotCurve("История");
+    historyCurve->setPen(QPen(Qt::gray, 1));
+    historyCurve->setZ(curve->z() - 1);
+    historyCurve->attach(plot);
+
     // QWidget *central = new QWidget(this);
     // QVBoxLayout *layout = new QVBoxLayout(central);
     // layout->addWidget(plot);
     // setCentralWidget(central);
     ui->tabGraphics->addTab(plot, "fsdfa");
 
-    connect(timer, &QTimer::timeout, [this](){ getTemperatur(); });
-    timer->start(1000);  // Каждую секунду
+    // опрос температуры ведёт сам HidWorker по монотонным часам (setPollIntervalMs)
 
 }
 
 MainWindow::~MainWindow()
 {
+    // Поток ввода-вывода пишет в store. Остановился в срок — удаляем воркер до
+    // разрушения членов. Завис в hid_write/hid_open — сознательно бросаем воркер
+    // (и store, который он держит через shared_ptr): выход важнее уборки.
+    if (m_hidWorker->stop()) {
+        delete m_hidWorker;
+    } else {
+        qWarning() << "HID I/O thread is stuck, leaving it behind on exit";
+        m_hidWorker->setParent(nullptr);
+    }
+    m_hidWorker = nullptr;
     delete ui;
 }
 
-void MainWindow::onHidData(const QByteArray &data)
+void MainWindow::onHidData(const QByteArray &data, const SampleTime &time)
 {
-    // Преобразуем float в 4 байта
-    union {
-        float f;
-        int32_t u;
-        int8_t b[4];
-    } converter;
-
-    float value = 0.0;
-    // По байтам (обычно little-endian)
-    // qDebug() << data[0] << data[1];
-    converter.b[3] = data[3];
-    converter.b[2] = data[2];
-    converter.b[1] = data[1];
-    converter.b[0] = data[0];
-    uint32_t command = converter.u;
-    switch (command) {
-    case 0x20:      // receive temperature
-        converter.b[0] = data[4];
-        converter.b[1] = data[5];
-        converter.b[2] = data[6];
-        converter.b[3] = data[7];
-        addDataPoint(converter.f);
-        break;
-    case 0x21:
-        // value = converter.f;
-        converter.b[0] = data[4];
-        converter.b[1] = data[5];
-        converter.b[2] = data[6];
-        converter.b[3] = data[7];
-        ui->lblPID_P->setText(tr("pid_P=%1").arg(converter.f));
-        qDebug() << "receive PID_P" << converter.f;
-        break;
-    case 0x22:
-        // value = converter.f;
-        converter.b[0] = data[4];
-        converter.b[1] = data[5];
-        converter.b[2] = data[6];
-        converter.b[3] = data[7];
-        ui->lblPID_D->setText(tr("pid_D=%1").arg(converter.f));
-        qDebug() << "receive PID_D" << converter.f;
-        break;
-    case 0x23:
-        // value = converter.u;
-        converter.b[0] = data[4];
-        converter.b[1] = data[5];
-        converter.b[2] = data[6];
-        converter.b[3] = data[7];
-        ui->lblCompressionOnTime->setText(tr("compressionOnTime=%1").arg(converter.u));
-        qDebug() << "receive compressorOnTime" << converter.u;
-        break;
-    case 0x24:
-        // value = converter.u;
-        converter.b[0] = data[4];
-        converter.b[1] = data[5];
-        converter.b[2] = data[6];
-        converter.b[3] = data[7];
-        qDebug() << "receive cycleTime" << converter.u;
-        break;
-    case 0x25:
-        // value = converter.u;
-        converter.b[0] = data[4];
-        converter.b[1] = data[5];
-        converter.b[2] = data[6];
-        converter.b[3] = data[7];
-        ui->lblSetPoint->setText(tr("setpoint=%1").arg(converter.f));
-        qDebug() << "receive setpoint" << converter.f;
-        break;
-    }
-
+    Q_UNUSED(time);  // отсчёты с метками времени уже лежат в store
+
+    // Отчёт может быть классическим (одно значение) или упакованным (несколько)
+    bool refresh = false;
+    HidProtocol::decode(reinterpret_cast<const uchar*>(data.constData()), data.size(),
+                        [&](quint32 command, const uchar* payload, int ageMs) {
+        Q_UNUSED(ageMs);
+        switch (command) {
+        case HidProtocol::GetTemperature:
+            refresh = true;
+            if (!firstSampleSeen) {
+                firstSampleSeen = true;
+                StartupTrace::mark("first sample");
+                saveStartupTraceIfComplete();
+            }
+            break;
+        case HidProtocol::GetPidP: {
+            const float v = HidProtocol::readFloat(payload);
+            ui->lblPID_P->setText(tr("pid_P=%1").arg(v));
+            qDebug() << "receive PID_P" << v;
+            break;
+        }
+        case HidProtocol::GetPidD: {
+            const float v = HidProtocol::readFloat(payload);
+            ui->lblPID_D->setText(tr("pid_D=%1").arg(v));
+            qDebug() << "receive PID_D" << v;
+            break;
+        }
+        case HidProtocol::GetCompressorOnTime: {
+            const quint32 v = HidProtocol::readU32(payload);
+            ui->lblCompressionOnTime->setText(tr("compressionOnTime=%1").arg(v));
+            qDebug() << "receive compressorOnTime" << v;
+            break;
+        }
+        case HidProtocol::GetCycleTime:
+            qDebug() << "receive cycleTime" << HidProtocol::readU32(payload);
+            break;
+        case HidProtocol::GetSetPoint: {
+            const float v = HidProtocol::readFloat(payload);
+            ui->lblSetPoint->setText(tr("setpoint=%1").arg(v));
+            qDebug() << "receive setpoint" << v;
+            refresh = true;
+            break;
+        }
+        }
+    });
+    // один replot на отчёт, сколько бы отсчётов в нём ни было
+    if (refresh)
+        refreshFromStore();
+    // для замера задержки доставки при прогоне записи
+    m_hidWorker->dataConsumed();
+}
 
+void MainWindow::onReplayFinished()
+{
+    const ReplayStats st = m_hidWorker->replayStats();
+    const double sec = st.elapsedNs / 1e9;
+    const QString text = tr("Прогон завершён: %1 отчётов (%2 значений) за %3 с, %4 отч/с; "
+                            "конвейер %5/%6 мкс, доставка в GUI %7/%8 мкс (среднее/макс)")
+                             .arg(st.reports)
+                             .arg(st.values)
+                             .arg(sec, 0, 'f', 2)
+                             .arg(sec > 0 ? st.reports / sec : 0.0, 0, 'f', 0)
+                             .arg(st.meanProcessUs, 0, 'f', 1)
+                             .arg(st.maxProcessUs)
+                             .arg(st.meanDeliveryUs, 0, 'f', 1)
+                             .arg(st.maxDeliveryUs);
+    qDebug() << text;
+    statusBar()->showMessage(text);
 }
 
 void MainWindow::on_pushButton_2_clicked()
@@ -168,41 +375,102 @@ void MainWindow::on_btnTest_clicked()
     setTemperatur();
 }
 
-void MainWindow::addDataPoint(double curTemp)
+void MainWindow::refreshFromStore()
 {
-    // Для примера — случайная температура от 23 до 27 °C
-    // qDebug() << "add " << curTemp;
-
-    tempLogger->setTemperatureProvider(curTemp);
-
-
-    elapsedTime += 1.0;
-
-    timeData.append(elapsedTime);
-    tempData.append(curTemp);
-
-    // Для красивого отображения — показываем только последние 60 точек
-    if (timeData.size() > COUNT_POINTS) {
-        timeData.removeFirst();
-        tempData.removeFirst();
-        plot->setAxisScale(QwtPlot::xBottom, timeData.first(), timeData.last());
-    }
+    if (!plot)
+        return;     // график ещё не создан — курсоры подождут
+
+    // Новые отсчёты — в аналитику, по курсорам: каждый читается ровно один раз
+    store->read(setpointCursor, [this](const TimeSeriesStore::Sample &s) {
+        analytics->setSetpoint(s.value);
+    });
+    store->read(tempCursor, [this](const TimeSeriesStore::Sample &s) {
+        if (plotOriginNs == 0)
+            plotOriginNs = s.monoNs;
+        analytics->addTemperature((s.monoNs - plotOriginNs) / 1e9, s.value);
+    });
+
+    TimeSeriesStore::Sample last;
+    if (!store->latest(TimeSeriesStore::Temperature, &last))
+        return;
+
+    // ось X — реальное время прихода отсчёта: опоздания и пропуски видны как есть
+    tempSeries->update(plotOriginNs, last.monoNs, PLOT_WINDOW_SEC);
+    setpointSeries->update(plotOriginNs, last.monoNs, PLOT_WINDOW_SEC, last.monoNs);
+
+    const double t = (last.monoNs - plotOriginNs) / 1e9;
+    const bool hasHistory = historyCurve->dataSize() > 0;
+    if (t > PLOT_WINDOW_SEC || hasHistory)
+        plot->setAxisScale(QwtPlot::xBottom, t - PLOT_WINDOW_SEC, t);
 
     // Автоматическое масштабирование по Y
-    auto minMax = std::minmax_element(tempData.begin(), tempData.end());
-    double minY = *minMax.first;
-    double maxY = *minMax.second;
+    const QRectF rect = tempSeries->boundingRect();
+    double minY = rect.top();
+    double maxY = rect.bottom();
+    if (hasHistory) {
+        const QRectF hist = historyCurve->boundingRect();
+        minY = qMin(minY, hist.top());
+        maxY = qMax(maxY, hist.bottom());
+    }
+    if (setpointSeries->size() > 0) {
+        const QRectF sp = setpointSeries->boundingRect();
+        minY = qMin(minY, sp.top());
+        maxY = qMax(maxY, sp.bottom());
+    }
 
     // Немного отступа сверху/снизу для красоты
     double margin = (maxY - minY) * 0.1;
     if (margin < 0.5) margin = 0.5; // Не слишком тонкая ось
     plot->setAxisScale(QwtPlot::yLeft, minY - margin, maxY + margin);
 
-
-    curve->setSamples(timeData.data(), tempData.data(), timeData.size());
     plot->replot();
 }
 
+void MainWindow::onAnalyticsUpdated(const AnalyticsSnapshot &snapshot)
+{
+    QString text = tr("EWMA=%1  σ=%2  в полосе=%3%  компрессор=%4%  пуски=%5")
+                       .arg(snapshot.ewma, 0, 'f', 2)
+                       .arg(snapshot.variance.isEmpty() ? 0.0 : qSqrt(snapshot.variance.first()), 0, 'f', 3)
+                       .arg(snapshot.inBandRatio * 100.0, 0, 'f', 1)
+                       .arg(snapshot.dutyCycle * 100.0, 0, 'f', 1)
+                       .arg(snapshot.compressorStarts);
+    if (!qIsNaN(snapshot.setpoint))
+        text += tr("  перерег.=+%1/-%2")
+                    .arg(snapshot.overshoot, 0, 'f', 2)
+                    .arg(snapshot.undershoot, 0, 'f', 2);
+    const PollJitter jitter = m_hidWorker->pollJitter();
+    text += tr("  опрос: +%1 мс (макс %2, интервал ±%3)")
+                .arg(jitter.lastLateUs / 1000.0, 0, 'f', 1)
+                .arg(jitter.maxLateUs / 1000.0, 0, 'f', 1)
+                .arg(jitter.maxIntervalErrUs / 1000.0, 0, 'f', 1);
+    lblAnalytics->setText(text);
+}
+
+void MainWindow::openPidTuning()
+{
+    auto *dlg = new PidTuningDialog(QDir(logDir).absolutePath(), this);
+    dlg->setAttribute(Qt::WA_DeleteOnClose);
+    if (!qIsNaN(analytics->snapshot().setpoint))
+        dlg->setSetpoint(analytics->snapshot().setpoint);
+    connect(dlg, &PidTuningDialog::applyRequested, this, &MainWindow::applyTunedParams);
+    dlg->show();
+}
+
+void MainWindow::applyTunedParams(const ControllerParams &params)
+{
+    // Оператор уже подтвердил в диалоге — отправляем штатными командами 0x11–0x14
+    ui->doubleSpinPID_P->setValue(params.pidP);
+    ui->doubleSpinPID_D->setValue(params.pidD);
+    ui->spinTimeBaseWork->setValue(int(params.onTime));
+    ui->spinTimeCycle->setValue(int(params.cycleTime));
+    setPID_P();
+    setPID_D();
+    setCompressorOnTime();
+    setCycleTime();
+    // перечитать, что реально приняло устройство
+    on_pushButton_2_clicked();
+}
+
 void MainWindow::setTemperatur()
 {
     float value = ui->spinSetPoint->value();
@@ -372,16 +640,19 @@ void MainWindow::getSetPoint()
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
-    // Сначала даём знать worker-у, что пора остановиться
+    // Останавливаем поток ввода-вывода: stop() ждёт его не дольше setJoinTimeoutMs,
+    // устройство закрывается в самом потоке
     if (m_hidWorker) {
-        m_hidWorker->stop();         // в stop() у тебя m_running = false и hid_close
+        m_hidWorker->stop();
     }
 
-    // Просим поток выйти из цикла и дожидаемся его окончания
-    if (m_hidThread && m_hidThread->isRunning()) {
-        m_hidThread->quit();         // пошлёт сигнал QThread::finished()
-        m_hidThread->wait(2000);     // ждём до 2 секунд (или Q_UINT64_C(ULONG_MAX) для бесконечно)
-    }
+    // закрыли раньше отложенной инициализации — журнал уже не запускаем
+    deferredInitDone = true;
+    StartupTrace::save(logDir + "/startup_trace.log");
+
+    // Дописать и сбросить на диск хвост лога
+    if (tempLogger)
+        tempLogger->stop();
 
     // Теперь можно спокойно закрываться
     QMainWindow::closeEvent(event);
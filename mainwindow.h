@@ -4,6 +4,8 @@
 #include <QMainWindow>
 #include <QThread>
 #include <QTimer>
+#include <QFutureWatcher>
+#include <QVector>
 
 
 #include <qwt/qwt_plot.h>
@@ -12,6 +14,13 @@
 #include "hidworker.h"
 
 #include "temperaturelogger.h"
+#include "streamanalytics.h"
+#include "thermalmodel.h"
+#include "timeseriesstore.h"
+
+class StoreSeriesData;
+
+class QLabel;
 
 
 
@@ -29,12 +38,12 @@ public:
 private:
     Ui::MainWindow *ui;
     HidWorker* m_hidWorker;
-    QThread*   m_hidThread;
 
 
 
     // void connectToHID();
     void createPlot();
+    void setupAlarms();
 
 public slots:
     void setTemperatur();
@@ -54,10 +63,16 @@ public slots:
     void getSetPoint();
 
 private slots:
-    void onHidData(const QByteArray &data);
+    void onHidData(const QByteArray &data, const SampleTime &time);
     void on_pushButton_2_clicked();
     void on_btnTest_clicked();
-    void addDataPoint(double curTemp);
+    void refreshFromStore();
+    void onAnalyticsUpdated(const AnalyticsSnapshot &snapshot);
+    void onAlarm(const AlarmEvent &event);
+    void onReplayFinished();
+    void deferredInit();        // график, журнал и история — после первого кадра
+    void onHistoryLoaded();
+    void saveStartupTraceIfComplete();
 
 
     void on_btnSetPID_P_clicked();
@@ -66,20 +81,38 @@ private slots:
 
     void on_btnSetTimeBaseWork_clicked();
 
+    void openPidTuning();
+    void applyTunedParams(const ControllerParams &params);
+
 private:
-    QwtPlot *plot;
-    QwtPlotCurve *curve;
-    QVector<double> timeData;
-    QVector<double> tempData;
-    QTimer *timer;
+    QwtPlot *plot = nullptr;
+    QwtPlotCurve *curve = nullptr;
+    QwtPlotCurve *setpointCurve = nullptr;
+    QwtPlotCurve *historyCurve = nullptr;
+    StoreSeriesData *tempSeries = nullptr;      // принадлежат кривым
+    StoreSeriesData *setpointSeries = nullptr;
+    // пишет поток HID, читают все остальные; общий с воркером, чтобы пережить
+    // окно, если поток ввода-вывода не остановился к выходу
+    std::shared_ptr<TimeSeriesStore> store = std::make_shared<TimeSeriesStore>();
+    TimeSeriesStore::Cursor tempCursor;
+    TimeSeriesStore::Cursor setpointCursor;
     TemperatureLogger *tempLogger = nullptr;
-    double elapsedTime = 0;
+    StreamAnalytics *analytics = nullptr;
+    QLabel *lblAnalytics = nullptr;
+    QLabel *lblSync = nullptr;
+    qint64 plotOriginNs = 0;    // монотонное время первого отсчёта на графике
+    QString logDir = "logs";    // при прогоне записи — logs/replay
+    QFutureWatcher<QVector<TemperatureLogger::Record>> *historyWatcher = nullptr;
+    bool firstFrameShown = false;
+    bool deferredInitDone = false;
+    bool firstSampleSeen = false;
 
 signals:
     void sendToHid(const QByteArray &data);
 
 protected:
     void closeEvent(QCloseEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
 
 };
 
@@ -0,0 +1,279 @@
+#include "pidtuningdialog.h"
+#include <QDoubleSpinBox>
+#include <QSpinBox>
+#include <QLabel>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QDir>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+
+#define MAX_SHOWN_RESULTS 50
+// Больше вариантов не держим в памяти и не гоняем: это часы счёта
+#define MAX_SWEEP_CANDIDATES 200000
+
+PidTuningDialog::PidTuningDialog(const QString& logDir, QWidget* parent)
+    : QDialog(parent), logDir_(logDir)
+{
+    setWindowTitle("Подбор параметров регулятора");
+
+    auto* form = new QFormLayout;
+
+    ambient_ = new QDoubleSpinBox(this);
+    ambient_->setRange(-20, 50);
+    ambient_->setValue(20);
+    form->addRow("Температура снаружи, °C", ambient_);
+
+    setpoint_ = new QDoubleSpinBox(this);
+    setpoint_->setRange(-40, 10);
+    setpoint_->setValue(-2);
+    form->addRow("Уставка, °C", setpoint_);
+
+    startOffset_ = new QDoubleSpinBox(this);
+    startOffset_->setRange(0.5, 20);
+    startOffset_->setValue(3);
+    form->addRow("Начальное отклонение, °C", startOffset_);
+
+    horizonH_ = new QDoubleSpinBox(this);
+    horizonH_->setRange(0.5, 48);
+    horizonH_->setValue(6);
+    form->addRow("Длительность прогона, ч", horizonH_);
+
+    rangeP_     = addRange(form, "PID P",          0, 100,   0.1, 2);
+    rangeD_     = addRange(form, "PID D",          0, 1000,  1,   2);
+    // пределы — как у spinTimeBaseWork / spinTimeCycle в главном окне
+    rangeOn_    = addRange(form, "Время работы, с", 0, 100,  5,   0);
+    rangeCycle_ = addRange(form, "Время цикла, с",  10, 300, 10,  0);
+
+    rangeP_.from->setValue(0.5);      rangeP_.to->setValue(5);       rangeP_.steps->setValue(10);
+    rangeD_.from->setValue(0);        rangeD_.to->setValue(100);     rangeD_.steps->setValue(6);
+    rangeOn_.from->setValue(5);       rangeOn_.to->setValue(100);    rangeOn_.steps->setValue(10);
+    rangeCycle_.from->setValue(30);   rangeCycle_.to->setValue(300); rangeCycle_.steps->setValue(10);
+
+    lblModel_ = new QLabel("Модель не подогнана", this);
+    lblStatus_ = new QLabel(this);
+
+    btnFit_ = new QPushButton("Подогнать модель по логам", this);
+    btnRun_ = new QPushButton("Перебрать", this);
+    btnRun_->setEnabled(false);
+    btnApply_ = new QPushButton("Отправить в устройство...", this);
+    btnApply_->setEnabled(false);
+
+    table_ = new QTableWidget(0, 8, this);
+    table_->setHorizontalHeaderLabels({"P", "D", "Работа, с", "Цикл, с",
+                                       "Установление, мин", "Перерег., °C", "Пуски", "Оценка"});
+    table_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table_->setSelectionMode(QAbstractItemView::SingleSelection);
+    table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table_->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    auto* buttons = new QHBoxLayout;
+    buttons->addWidget(btnFit_);
+    buttons->addWidget(btnRun_);
+    buttons->addStretch();
+    buttons->addWidget(btnApply_);
+
+    auto* layout = new QVBoxLayout(this);
+    layout->addLayout(form);
+    layout->addWidget(lblModel_);
+    layout->addLayout(buttons);
+    layout->addWidget(lblStatus_);
+    layout->addWidget(table_);
+
+    connect(btnFit_, &QPushButton::clicked, this, &PidTuningDialog::onFitModel);
+    connect(&fitWatcher_, &QFutureWatcher<FitResult>::finished,
+            this, &PidTuningDialog::onFitFinished);
+    connect(btnRun_, &QPushButton::clicked, this, &PidTuningDialog::onRunSweep);
+    connect(btnApply_, &QPushButton::clicked, this, &PidTuningDialog::onApply);
+    connect(&watcher_, &QFutureWatcher<SimulationResult>::finished,
+            this, &PidTuningDialog::onSweepFinished);
+    connect(&watcher_, &QFutureWatcher<SimulationResult>::progressValueChanged, this, [this](int v) {
+        lblStatus_->setText(QString("Прогон %1 из %2...").arg(v).arg(watcher_.progressMaximum()));
+    });
+}
+
+PidTuningDialog::~PidTuningDialog() {
+    watcher_.cancel();
+    watcher_.waitForFinished();
+    // разбор логов не прерывается — дожидаемся, он ничего не знает о диалоге
+    fitWatcher_.waitForFinished();
+}
+
+void PidTuningDialog::setSetpoint(double setpoint) {
+    setpoint_->setValue(setpoint);
+}
+
+PidTuningDialog::Range PidTuningDialog::addRange(QFormLayout* form, const QString& title,
+                                                 double min, double max, double step, int decimals) {
+    Range r;
+    r.from = new QDoubleSpinBox(this);
+    r.to = new QDoubleSpinBox(this);
+    for (QDoubleSpinBox* sb : {r.from, r.to}) {
+        sb->setRange(min, max);
+        sb->setSingleStep(step);
+        sb->setDecimals(decimals);
+    }
+    r.steps = new QSpinBox(this);
+    r.steps->setRange(1, 100);
+
+    auto* row = new QHBoxLayout;
+    row->addWidget(r.from);
+    row->addWidget(new QLabel("…", this));
+    row->addWidget(r.to);
+    row->addWidget(new QLabel("шагов", this));
+    row->addWidget(r.steps);
+    form->addRow(title, row);
+    return r;
+}
+
+QVector<double> PidTuningDialog::expand(const Range& r) {
+    QVector<double> out;
+    const int n = r.steps->value();
+    const double a = r.from->value();
+    const double b = r.to->value();
+    if (n <= 1) {
+        out.append(a);
+        return out;
+    }
+    for (int i = 0; i < n; ++i)
+        out.append(a + (b - a) * i / (n - 1));
+    return out;
+}
+
+void PidTuningDialog::onFitModel() {
+    if (fitWatcher_.isRunning())
+        return;
+
+    // разбор всех ротированных логов — десятки мегабайт, поэтому в пуле потоков
+    const QString logDir = logDir_;
+    const double ambient = ambient_->value();
+    btnFit_->setEnabled(false);
+    btnRun_->setEnabled(false);
+    lblModel_->setText("Подгонка модели по логам...");
+    fitWatcher_.setFuture(QtConcurrent::run([logDir, ambient]() {
+        FitResult r;
+        QStringList files;
+        for (const QFileInfo& fi : QDir(logDir).entryInfoList({"temperature_log*.csv"}, QDir::Files))
+            files.append(fi.absoluteFilePath());
+        r.files = files.size();
+        r.model = ThermalModel::fitFromLogs(files, ambient, &r.error);
+        return r;
+    }));
+}
+
+void PidTuningDialog::onFitFinished() {
+    const FitResult r = fitWatcher_.result();
+    btnFit_->setEnabled(true);
+    model_ = r.model;
+    if (!model_.valid) {
+        lblModel_->setText(QString("Ошибка подгонки: %1").arg(r.error));
+        btnRun_->setEnabled(false);
+        return;
+    }
+    lblModel_->setText(QString("Файлов: %1, интервалов: %2; теплоприток a=%3 1/ч, холодопроизв. b=%4 °C/ч")
+                           .arg(r.files)
+                           .arg(model_.pointsUsed)
+                           .arg(model_.leak * 3600.0, 0, 'g', 4)
+                           .arg(model_.cooling * 3600.0, 0, 'g', 4));
+    btnRun_->setEnabled(true);
+}
+
+void PidTuningDialog::onRunSweep() {
+    if (watcher_.isRunning())
+        return;
+
+    QVector<ControllerParams> grid;
+    const QVector<double> ps = expand(rangeP_);
+    const QVector<double> ds = expand(rangeD_);
+    const QVector<double> ons = expand(rangeOn_);
+    const QVector<double> cycles = expand(rangeCycle_);
+    const qint64 total = qint64(ps.size()) * ds.size() * ons.size() * cycles.size();
+    if (total > MAX_SWEEP_CANDIDATES) {
+        lblStatus_->setText(QString("Слишком много вариантов: %1, допустимо не больше %2 — уменьшите число шагов")
+                                .arg(total).arg(MAX_SWEEP_CANDIDATES));
+        return;
+    }
+    grid.reserve(int(total));
+    for (double p : ps)
+        for (double d : ds)
+            for (double on : ons)
+                for (double cycle : cycles) {
+                    if (on > cycle) continue;  // работа дольше цикла не имеет смысла
+                    ControllerParams c;
+                    c.pidP = p;
+                    c.pidD = d;
+                    c.onTime = quint32(qRound(on));
+                    c.cycleTime = quint32(qRound(cycle));
+                    grid.append(c);
+                }
+
+    SimulationSettings settings;
+    settings.setpoint = setpoint_->value();
+    settings.startOffset = startOffset_->value();
+    settings.horizonSec = horizonH_->value() * 3600.0;
+
+    const ThermalModel model = model_;
+    btnRun_->setEnabled(false);
+    btnApply_->setEnabled(false);
+    lblStatus_->setText(QString("Прогон %1 вариантов на %2 потоках...")
+                            .arg(grid.size()).arg(QThread::idealThreadCount()));
+    watcher_.setFuture(QtConcurrent::mapped(grid, [model, settings](const ControllerParams& c) {
+        return simulateController(model, c, settings);
+    }));
+}
+
+void PidTuningDialog::onSweepFinished() {
+    btnRun_->setEnabled(model_.valid && !fitWatcher_.isRunning());
+    if (watcher_.isCanceled())
+        return;
+
+    const QList<SimulationResult> all = watcher_.future().results();
+    results_ = QVector<SimulationResult>(all.begin(), all.end());
+    std::sort(results_.begin(), results_.end(),
+              [](const SimulationResult& a, const SimulationResult& b) { return a.score < b.score; });
+
+    const int shown = qMin<int>(results_.size(), MAX_SHOWN_RESULTS);
+    table_->setRowCount(shown);
+    for (int i = 0; i < shown; ++i) {
+        const SimulationResult& r = results_[i];
+        const QStringList cells = {
+            QString::number(r.params.pidP, 'f', 2),
+            QString::number(r.params.pidD, 'f', 2),
+            QString::number(r.params.onTime),
+            QString::number(r.params.cycleTime),
+            QString::number(r.settlingSec / 60.0, 'f', 1),
+            QString::number(r.overshoot, 'f', 2),
+            QString::number(r.starts),
+            QString::number(r.score, 'f', 3),
+        };
+        for (int c = 0; c < cells.size(); ++c)
+            table_->setItem(i, c, new QTableWidgetItem(cells[c]));
+    }
+    if (shown > 0)
+        table_->selectRow(0);
+    btnApply_->setEnabled(shown > 0);
+    lblStatus_->setText(QString("Готово: %1 вариантов").arg(results_.size()));
+}
+
+void PidTuningDialog::onApply() {
+    const int row = table_->currentRow();
+    if (row < 0 || row >= results_.size())
+        return;
+    const ControllerParams& c = results_[row].params;
+    const auto answer = QMessageBox::question(
+        this, "Отправка параметров",
+        QString("Отправить в устройство P=%1, D=%2, время работы=%3 с, цикл=%4 с?")
+            .arg(c.pidP, 0, 'f', 2)
+            .arg(c.pidD, 0, 'f', 2)
+            .arg(c.onTime)
+            .arg(c.cycleTime));
+    if (answer != QMessageBox::Yes)
+        return;
+    emit applyRequested(c);
+}
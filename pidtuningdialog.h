@@ -0,0 +1,78 @@
+#ifndef PIDTUNINGDIALOG_H
+#define PIDTUNINGDIALOG_H
+
+#include <QDialog>
+#include <QFutureWatcher>
+#include <QVector>
+
+#include "thermalmodel.h"
+
+class QDoubleSpinBox;
+class QSpinBox;
+class QFormLayout;
+class QLabel;
+class QTableWidget;
+class QPushButton;
+
+// Офлайн-подбор параметров регулятора: модель камеры подгоняется по логам,
+// затем сетка (P, D, onTime, cycleTime) прогоняется на модели параллельно
+// на всех ядрах. В устройство ничего не уходит без подтверждения оператора.
+class PidTuningDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit PidTuningDialog(const QString& logDir, QWidget* parent = nullptr);
+    ~PidTuningDialog();
+
+    void setSetpoint(double setpoint);
+
+signals:
+    void applyRequested(const ControllerParams& params);
+
+private slots:
+    void onFitModel();
+    void onFitFinished();
+    void onRunSweep();
+    void onSweepFinished();
+    void onApply();
+
+private:
+    struct Range {
+        QDoubleSpinBox* from;
+        QDoubleSpinBox* to;
+        QSpinBox* steps;
+    };
+    Range addRange(QFormLayout* form, const QString& title,
+                   double min, double max, double step, int decimals);
+    static QVector<double> expand(const Range& r);
+
+    struct FitResult {
+        ThermalModel model;
+        QString error;
+        int files = 0;
+    };
+
+    QString logDir_;
+    ThermalModel model_;
+
+    QDoubleSpinBox* ambient_;
+    QDoubleSpinBox* setpoint_;
+    QDoubleSpinBox* startOffset_;
+    QDoubleSpinBox* horizonH_;
+    Range rangeP_;
+    Range rangeD_;
+    Range rangeOn_;
+    Range rangeCycle_;
+    QLabel* lblModel_;
+    QLabel* lblStatus_;
+    QTableWidget* table_;
+    QPushButton* btnFit_;
+    QPushButton* btnRun_;
+    QPushButton* btnApply_;
+
+    QFutureWatcher<FitResult> fitWatcher_;
+    QFutureWatcher<SimulationResult> watcher_;
+    QVector<SimulationResult> results_;
+};
+
+#endif // PIDTUNINGDIALOG_H
@@ -0,0 +1,34 @@
+#include "sampleclock.h"
+#include <QDateTime>
+#include <chrono>
+
+SampleClock::SampleClock() {
+    qRegisterMetaType<SampleTime>("SampleTime");
+    reanchor();
+}
+
+void SampleClock::reanchor() {
+    anchorMonoNs_ = monotonicNs();
+    anchorWallMs_ = QDateTime::currentMSecsSinceEpoch();
+}
+
+qint64 SampleClock::resyncIfDrifted(qint64 maxDriftMs) {
+    const qint64 systemMs = QDateTime::currentMSecsSinceEpoch();
+    const qint64 driftMs = systemMs - now().wallMs;
+    if (qAbs(driftMs) <= maxDriftMs)
+        return 0;
+    reanchor();
+    return driftMs;
+}
+
+SampleTime SampleClock::now() const {
+    SampleTime t;
+    t.monoNs = monotonicNs();
+    t.wallMs = anchorWallMs_ + (t.monoNs - anchorMonoNs_) / 1000000;
+    return t;
+}
+
+qint64 SampleClock::monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
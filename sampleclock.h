@@ -0,0 +1,38 @@
+#ifndef SAMPLECLOCK_H
+#define SAMPLECLOCK_H
+
+#include <QtGlobal>
+#include <QMetaType>
+
+// Метка времени отсчёта: монотонное время для интервалов (графики, аналитика,
+// тревоги) и настенное время для журнала. Ставится в HidWorker сразу после
+// возврата hid_read_timeout и дальше передаётся вместе с данными.
+struct SampleTime {
+    qint64 monoNs = 0;   // steady_clock, нс
+    qint64 wallMs = 0;   // мс с эпохи (UTC)
+
+    bool isValid() const { return monoNs != 0; }
+};
+Q_DECLARE_METATYPE(SampleTime)
+
+// Настенное время выводится из монотонного через якорь, снятый при старте:
+// переводы системных часов не ломают порядок и интервалы отсчётов.
+class SampleClock {
+public:
+    SampleClock();
+
+    void reanchor();            // заново привязать к системным часам
+    // Перепривязать, если настенное время ушло от системного больше чем на
+    // maxDriftMs (шаг NTP, ручная правка часов, накопленный дрейф QPC).
+    // Возвращает расхождение до перепривязки, мс (0 — не понадобилась).
+    qint64 resyncIfDrifted(qint64 maxDriftMs = 1000);
+    SampleTime now() const;
+
+    static qint64 monotonicNs();
+
+private:
+    qint64 anchorMonoNs_ = 0;
+    qint64 anchorWallMs_ = 0;
+};
+
+#endif // SAMPLECLOCK_H
@@ -0,0 +1,69 @@
+#include "startuptrace.h"
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QVector>
+#include <QDebug>
+
+namespace {
+
+struct Mark {
+    QByteArray what;
+    double     ms;
+};
+
+QElapsedTimer g_timer;
+QVector<Mark> g_marks;
+bool g_saved = false;
+
+} // namespace
+
+namespace StartupTrace {
+
+void start() {
+    g_timer.start();
+    g_marks.clear();
+    g_saved = false;
+    mark("main() start");
+}
+
+double elapsedMs() {
+    return g_timer.isValid() ? g_timer.nsecsElapsed() / 1e6 : 0.0;
+}
+
+void mark(const char* what) {
+    for (const Mark& m : g_marks)
+        if (m.what == what)
+            return;
+    const double ms = elapsedMs();
+    g_marks.append({QByteArray(what), ms});
+    qDebug().noquote() << QString(">>> [%1 ms] %2").arg(ms, 7, 'f', 1).arg(QString::fromUtf8(what));
+}
+
+bool hasMark(const char* what) {
+    for (const Mark& m : g_marks)
+        if (m.what == what)
+            return true;
+    return false;
+}
+
+void save(const QString& path) {
+    if (g_saved || g_marks.isEmpty())
+        return;
+    g_saved = true;
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "StartupTrace: cannot open" << path;
+        return;
+    }
+    QByteArray line = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss").toUtf8();
+    for (const Mark& m : g_marks)
+        line += '\t' + m.what + '=' + QByteArray::number(m.ms, 'f', 1);
+    line += '\n';
+    f.write(line);
+}
+
+} // namespace StartupTrace
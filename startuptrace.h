@@ -0,0 +1,21 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QString>
+
+// Хронометраж запуска от первой строки main(): каждая отметка печатается
+// сразу, а когда собраны ключевые отметки (или при закрытии) весь след
+// дописывается строкой в журнал — так видно, как меняются time-to-first-frame
+// и time-to-first-sample.
+// Только поток GUI.
+namespace StartupTrace {
+
+void start();
+void mark(const char* what);                  // повторные отметки с тем же именем игнорируются
+bool hasMark(const char* what);
+double elapsedMs();
+void save(const QString& path);               // один раз за запуск
+
+} // namespace StartupTrace
+
+#endif // STARTUPTRACE_H
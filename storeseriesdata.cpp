@@ -0,0 +1,76 @@
+#include "storeseriesdata.h"
+
+StoreSeriesData::StoreSeriesData(const TimeSeriesStore* store, TimeSeriesStore::Channel channel)
+    : store_(store), channel_(channel)
+{}
+
+void StoreSeriesData::setHoldLast(bool hold) {
+    holdLast_ = hold;
+}
+
+void StoreSeriesData::update(qint64 originNs, qint64 newestNs, double windowSec, qint64 holdUntilNs) {
+    originNs_ = originNs;
+    const quint64 head = store_->head(channel_);
+    const quint64 oldest = store_->oldest(channel_);
+    const qint64 fromNs = newestNs - qint64(windowSec * 1e9);
+
+    // время в канале не убывает — ищем начало окна двоичным поиском
+    quint64 lo = oldest, hi = head;
+    TimeSeriesStore::Sample s;
+    while (lo < hi) {
+        const quint64 mid = lo + (hi - lo) / 2;
+        if (store_->at(channel_, mid, &s) && s.monoNs < fromNs)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    // для ступенчатого канала нужен последний отсчёт до окна — с него начинается ступенька
+    if (holdLast_ && lo > oldest)
+        --lo;
+    first_ = lo;
+    count_ = size_t(head - lo);
+
+    rect_ = QRectF();
+    hasHold_ = false;
+    double minX = 0, maxX = 0, minY = 0, maxY = 0;
+    bool any = false;
+    for (quint64 i = first_; i < head; ++i) {
+        if (!store_->at(channel_, i, &s))
+            continue;
+        const double x = toX(s.monoNs);
+        if (!any) {
+            minX = maxX = x;
+            minY = maxY = s.value;
+            any = true;
+        } else {
+            minX = qMin(minX, x); maxX = qMax(maxX, x);
+            minY = qMin(minY, s.value); maxY = qMax(maxY, s.value);
+        }
+    }
+    if (any && holdLast_ && holdUntilNs > 0 && store_->latest(channel_, &s)) {
+        holdPoint_ = QPointF(qMax(toX(holdUntilNs), toX(s.monoNs)), s.value);
+        hasHold_ = true;
+        maxX = qMax(maxX, holdPoint_.x());
+    }
+    if (any)
+        rect_ = QRectF(QPointF(minX, minY), QPointF(maxX, maxY));
+}
+
+size_t StoreSeriesData::size() const {
+    return count_ + (hasHold_ ? 1 : 0);
+}
+
+QPointF StoreSeriesData::sample(size_t i) const {
+    if (i >= count_)
+        return hasHold_ ? holdPoint_ : lastPoint_;
+    TimeSeriesStore::Sample s;
+    // отсчёт уже перезаписан (окно много меньше ёмкости, так что почти невозможно) —
+    // повторяем предыдущую точку
+    if (store_->at(channel_, first_ + i, &s))
+        lastPoint_ = QPointF(toX(s.monoNs), s.value);
+    return lastPoint_;
+}
+
+QRectF StoreSeriesData::boundingRect() const {
+    return rect_;
+}
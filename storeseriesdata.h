@@ -0,0 +1,44 @@
+#ifndef STORESERIESDATA_H
+#define STORESERIESDATA_H
+
+#include <qwt/qwt_series_data.h>
+
+#include "timeseriesstore.h"
+
+// Кривая Qwt поверх канала TimeSeriesStore — точки читаются прямо из
+// хранилища, без копии в QVector. Окно фиксируется вызовом update()
+// перед replot(), чтобы size()/sample() видели согласованный срез.
+class StoreSeriesData : public QwtSeriesData<QPointF>
+{
+public:
+    StoreSeriesData(const TimeSeriesStore* store, TimeSeriesStore::Channel channel);
+
+    // holdLast — держать последнее значение до holdUntilNs (ступенчатые
+    // каналы вроде уставки, которые приходят редко)
+    void setHoldLast(bool hold);
+
+    // originNs — ноль оси X; показываются отсчёты не старше windowSec
+    // от newestNs; holdUntilNs — куда протянуть последнее значение.
+    void update(qint64 originNs, qint64 newestNs, double windowSec, qint64 holdUntilNs = 0);
+
+    size_t size() const override;
+    QPointF sample(size_t i) const override;
+    QRectF boundingRect() const override;
+
+private:
+    double toX(qint64 monoNs) const { return (monoNs - originNs_) / 1e9; }
+
+    const TimeSeriesStore* store_;
+    TimeSeriesStore::Channel channel_;
+    bool    holdLast_ = false;
+
+    quint64 first_ = 0;
+    size_t  count_ = 0;
+    bool    hasHold_ = false;
+    QPointF holdPoint_;
+    qint64  originNs_ = 0;
+    QRectF  rect_;
+    mutable QPointF lastPoint_;
+};
+
+#endif // STORESERIESDATA_H
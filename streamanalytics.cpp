@@ -0,0 +1,162 @@
+#include "streamanalytics.h"
+#include <QtMath>
+#include <algorithm>
+
+StreamAnalytics::StreamAnalytics(QObject* parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<AnalyticsSnapshot>("AnalyticsSnapshot");
+    setVarianceWindows({60.0, 600.0, 3600.0});
+}
+
+void StreamAnalytics::setEwmaTauSec(double tau) {
+    tauEwma_ = tau > 0 ? tau : 1.0;
+}
+double StreamAnalytics::ewmaTauSec() const { return tauEwma_; }
+
+void StreamAnalytics::setVarianceWindows(const QVector<double>& seconds) {
+    windows_.clear();
+    snap_.windowSec.clear();
+    for (double s : seconds) {
+        if (s <= 0) continue;
+        Window w;
+        w.lengthSec = s;
+        windows_.append(w);
+        snap_.windowSec.append(s);
+    }
+    snap_.variance = QVector<double>(windows_.size(), qQNaN());
+}
+QVector<double> StreamAnalytics::varianceWindows() const { return snap_.windowSec; }
+
+void StreamAnalytics::setBand(double band) {
+    band_ = band > 0 ? band : 0.1;
+}
+double StreamAnalytics::band() const { return band_; }
+
+void StreamAnalytics::setDutyTauSec(double tau) {
+    tauDuty_ = tau > 0 ? tau : 1.0;
+}
+double StreamAnalytics::dutyTauSec() const { return tauDuty_; }
+
+void StreamAnalytics::setSlopeThreshold(double degPerMin) {
+    slopeThreshold_ = degPerMin >= 0 ? degPerMin : 0.0;
+}
+double StreamAnalytics::slopeThreshold() const { return slopeThreshold_; }
+
+const AnalyticsSnapshot& StreamAnalytics::snapshot() const { return snap_; }
+
+void StreamAnalytics::reset() {
+    const QVector<double> windows = snap_.windowSec;
+    const double sp = snap_.setpoint;
+    snap_ = AnalyticsSnapshot();
+    snap_.setpoint = sp;
+    hasSample_ = false;
+    crossed_ = false;
+    approachSign_ = 0;
+    setVarianceWindows(windows);
+}
+
+void StreamAnalytics::setSetpoint(double setpoint) {
+    // абсолютный допуск: qFuzzyCompare для 0 °C всегда false
+    if (!qIsNaN(snap_.setpoint) && qAbs(snap_.setpoint - setpoint) < 1e-4)
+        return;  // уставку переспросили, но она не менялась
+    snap_.setpoint = setpoint;
+    // перерегулирование считаем заново — от первого пересечения новой уставки
+    snap_.overshoot = 0.0;
+    snap_.undershoot = 0.0;
+    crossed_ = false;
+    approachSign_ = 0;
+}
+
+void StreamAnalytics::addTemperature(double timeSec, double temperature) {
+    if (qIsNaN(temperature))
+        return;
+
+    if (!hasSample_) {
+        hasSample_ = true;
+        snap_.time = timeSec;
+        snap_.temperature = temperature;
+        snap_.ewma = temperature;
+        for (Window& w : windows_)
+            w.add(timeSec, temperature);
+        emit updated(snap_);
+        return;
+    }
+
+    const double dt = timeSec - snap_.time;
+    if (dt <= 0)
+        return;  // отсчёт не новее предыдущего — пропускаем
+
+    // время в полосе — по состоянию на начало интервала
+    if (!qIsNaN(snap_.setpoint)) {
+        snap_.timeTotalSec += dt;
+        if (qAbs(snap_.temperature - snap_.setpoint) <= band_)
+            snap_.timeInBandSec += dt;
+        snap_.inBandRatio = snap_.timeInBandSec / snap_.timeTotalSec;
+    }
+
+    // EWMA с учётом неравномерного шага
+    const double prevEwma = snap_.ewma;
+    const double alpha = 1.0 - qExp(-dt / tauEwma_);
+    snap_.ewma += alpha * (temperature - snap_.ewma);
+
+    // скользящая дисперсия
+    for (int i = 0; i < windows_.size(); ++i) {
+        windows_[i].add(timeSec, temperature);
+        snap_.variance[i] = windows_[i].variance();
+    }
+
+    // перерегулирование после смены уставки
+    if (!qIsNaN(snap_.setpoint)) {
+        const double err = temperature - snap_.setpoint;
+        const int sign = err > 0 ? 1 : (err < 0 ? -1 : 0);
+        if (!crossed_) {
+            if (approachSign_ == 0)
+                approachSign_ = sign;
+            if (sign == 0 || sign != approachSign_ || qAbs(err) <= band_ * 0.1)
+                crossed_ = true;
+        }
+        if (crossed_) {
+            snap_.overshoot = std::max(snap_.overshoot, err);
+            snap_.undershoot = std::max(snap_.undershoot, -err);
+        }
+    }
+
+    // оценка работы компрессора: охлаждение — включён, нагрев — выключен
+    const double slopePerMin = (snap_.ewma - prevEwma) / dt * 60.0;
+    if (!snap_.compressorOn && slopePerMin < -slopeThreshold_) {
+        snap_.compressorOn = true;
+        ++snap_.compressorStarts;
+    } else if (snap_.compressorOn && slopePerMin > slopeThreshold_) {
+        snap_.compressorOn = false;
+    }
+    const double beta = 1.0 - qExp(-dt / tauDuty_);
+    snap_.dutyCycle += beta * ((snap_.compressorOn ? 1.0 : 0.0) - snap_.dutyCycle);
+
+    snap_.time = timeSec;
+    snap_.temperature = temperature;
+    emit updated(snap_);
+}
+
+void StreamAnalytics::Window::add(double t, double x) {
+    samples.emplace_back(t, x);
+    double n = double(samples.size());
+    double d = x - mean;
+    mean += d / n;
+    m2 += d * (x - mean);
+
+    // вытесняем устаревшие отсчёты (обратный шаг Уэлфорда)
+    while (samples.size() > 1 && t - samples.front().first > lengthSec) {
+        const double y = samples.front().second;
+        samples.pop_front();
+        n = double(samples.size());
+        d = y - mean;
+        mean -= d / n;
+        m2 -= d * (y - mean);
+    }
+    if (m2 < 0) m2 = 0;
+}
+
+double StreamAnalytics::Window::variance() const {
+    return samples.size() > 1 ? m2 / double(samples.size() - 1) : 0.0;
+}
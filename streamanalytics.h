@@ -0,0 +1,93 @@
+#ifndef STREAMANALYTICS_H
+#define STREAMANALYTICS_H
+
+#include <QObject>
+#include <QVector>
+#include <QMetaType>
+#include <QtNumeric>
+#include <deque>
+
+// Снимок потоковой статистики — отдаётся потребителям (UI, логгер) целиком,
+// чтобы никому не приходилось пересчитывать историю.
+struct AnalyticsSnapshot {
+    double time = 0.0;              // время последнего отсчёта, сек
+    double temperature = qQNaN();   // последний отсчёт
+    double ewma = qQNaN();          // сглаженная температура
+    double setpoint = qQNaN();      // текущая уставка (NaN — ещё не получена)
+
+    QVector<double> windowSec;      // окна скользящей дисперсии, сек
+    QVector<double> variance;       // дисперсия по каждому окну, °C²
+
+    double timeInBandSec = 0.0;     // время внутри ±band от уставки
+    double timeTotalSec = 0.0;      // время с известной уставкой
+    double inBandRatio = 0.0;       // доля времени в полосе, 0..1
+
+    double overshoot = 0.0;         // макс. выход выше уставки после её смены, °C
+    double undershoot = 0.0;        // макс. выход ниже уставки после её смены, °C
+
+    bool   compressorOn = false;    // оценка состояния компрессора по наклону EWMA
+    double dutyCycle = 0.0;         // оценка доли работы компрессора, 0..1
+    int    compressorStarts = 0;    // число оценённых включений
+};
+Q_DECLARE_METATYPE(AnalyticsSnapshot)
+
+// Потоковая аналитика: каждый отсчёт обрабатывается за O(1)
+// (для окон дисперсии — амортизированно O(1) на окно).
+class StreamAnalytics : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StreamAnalytics(QObject* parent = nullptr);
+
+    void setEwmaTauSec(double tau);          // постоянная времени EWMA, по умолчанию 60 с
+    double ewmaTauSec() const;
+
+    void setVarianceWindows(const QVector<double>& seconds); // по умолчанию 60, 600, 3600 с
+    QVector<double> varianceWindows() const;
+
+    void setBand(double band);               // полуширина полосы, по умолчанию 0.5 °C
+    double band() const;
+
+    void setDutyTauSec(double tau);          // усреднение скважности, по умолчанию 1800 с
+    double dutyTauSec() const;
+
+    // Порог наклона EWMA (°C/мин), выше которого считаем, что компрессор
+    // включён (охлаждение) или выключен (нагрев). Между порогами — без изменений.
+    void setSlopeThreshold(double degPerMin); // по умолчанию 0.02 °C/мин
+    double slopeThreshold() const;
+
+    const AnalyticsSnapshot& snapshot() const;
+
+public slots:
+    void addTemperature(double timeSec, double temperature);
+    void setSetpoint(double setpoint);
+    void reset();
+
+signals:
+    void updated(const AnalyticsSnapshot& snapshot);
+
+private:
+    // Скользящее окно по времени с дисперсией по Уэлфорду
+    struct Window {
+        double lengthSec = 0.0;
+        std::deque<std::pair<double, double>> samples; // (время, значение)
+        double mean = 0.0;
+        double m2 = 0.0;
+
+        void add(double t, double x);
+        double variance() const;
+    };
+
+    double tauEwma_ = 60.0;
+    double tauDuty_ = 1800.0;
+    double band_ = 0.5;
+    double slopeThreshold_ = 0.02;
+
+    QVector<Window> windows_;
+    AnalyticsSnapshot snap_;
+    bool hasSample_ = false;
+    bool crossed_ = false;    // температура уже пересекла новую уставку
+    int  approachSign_ = 0;   // с какой стороны подходили к уставке
+};
+
+#endif // STREAMANALYTICS_H
@@ -1,21 +1,99 @@
 #include "TemperatureLogger.h"
 #include <QTimer>
 #include <QFile>
-#include <QSaveFile>
 #include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <fcntl.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// QFile, открытый по имени, на Windows держит HANDLE, и handle() возвращает -1.
+// Открываем сами через CRT и отдаём дескриптор QFile — тогда _commit есть что сбрасывать.
+bool openWithFd(QFile& f, const QString& path, QIODevice::OpenMode mode) {
+#if defined(Q_OS_WIN)
+    // перевод строк делает сам QFile (QIODevice::Text), CRT — в двоичном режиме
+    int flags = _O_BINARY | _O_NOINHERIT;
+    flags |= (mode & QIODevice::ReadOnly) ? _O_RDWR : _O_WRONLY;
+    if (mode & QIODevice::Append)
+        flags |= _O_APPEND | _O_CREAT;
+    int fd = -1;
+    if (_wsopen_s(&fd, reinterpret_cast<const wchar_t*>(path.utf16()), flags,
+                  _SH_DENYNO, _S_IREAD | _S_IWRITE) != 0)
+        return false;
+    if (!f.open(fd, mode, QFileDevice::AutoCloseHandle)) {
+        _close(fd);
+        return false;
+    }
+    return true;
+#else
+    f.setFileName(path);
+    return f.open(mode);
+#endif
+}
+
+// Сбросить данные файла на носитель (метаданные вроде mtime не нужны)
+bool syncFileData(int fd) {
+    if (fd < 0)
+        return false;
+#if defined(Q_OS_WIN)
+    return _commit(fd) == 0;
+#elif defined(Q_OS_MACOS)
+    return fcntl(fd, F_FULLFSYNC) == 0 || fsync(fd) == 0;
+#else
+    return fdatasync(fd) == 0;
+#endif
+}
+
+// После rename нужно сбросить каталог, иначе новое имя может не пережить сбой
+void syncDirectory(const QString& dirPath) {
+#ifndef Q_OS_WIN
+    const int fd = ::open(QFile::encodeName(dirPath).constData(), O_RDONLY);
+    if (fd < 0) return;
+    ::fsync(fd);
+    ::close(fd);
+#else
+    Q_UNUSED(dirPath);  // NTFS журналирует rename сам
+#endif
+}
+
+} // namespace
 
 TemperatureLogger::TemperatureLogger(QObject* parent)
     : QObject(parent),
-    timer_(new QTimer(this))
+    timer_(new QTimer(this)),
+    syncTimer_(new QTimer(this))
 {
     connect(timer_, &QTimer::timeout, this, &TemperatureLogger::onTick);
     timer_->setTimerType(Qt::CoarseTimer);
+    connect(syncTimer_, &QTimer::timeout, this, &TemperatureLogger::syncNow);
+    syncTimer_->setTimerType(Qt::CoarseTimer);
+}
+
+TemperatureLogger::~TemperatureLogger() {
+    closeLog();
 }
 
-void TemperatureLogger::setTemperatureProvider(double provider) {
-    temperatureProvider_ = provider;
+void TemperatureLogger::setStore(const TimeSeriesStore* store) {
+    store_ = store;
+}
+
+void TemperatureLogger::setAnalytics(const AnalyticsSnapshot& snapshot) {
+    ewma_ = snapshot.ewma;
+    dutyCycle_ = snapshot.dutyCycle;
 }
 
 void TemperatureLogger::setLogFilePath(const QString& path) {
@@ -42,55 +120,155 @@ void TemperatureLogger::setMaxRotatedFiles(int count) {
 }
 int TemperatureLogger::maxRotatedFiles() const { return keepFiles_; }
 
+void TemperatureLogger::setDurability(DurabilityMode mode) {
+    durability_ = mode;
+    if (running_ && durability_ == GroupCommit)
+        syncTimer_->start(groupCommitMs_);
+    else
+        syncTimer_->stop();
+    if (durability_ != NoSync)
+        syncNow();  // не оставляем накопленное без fdatasync при смене режима
+}
+TemperatureLogger::DurabilityMode TemperatureLogger::durability() const { return durability_; }
+
+void TemperatureLogger::setGroupCommitMs(int ms) {
+    groupCommitMs_ = ms > 0 ? ms : 1000;
+    if (running_ && durability_ == GroupCommit)
+        syncTimer_->start(groupCommitMs_);
+}
+int TemperatureLogger::groupCommitMs() const { return groupCommitMs_; }
+
+qint64 TemperatureLogger::lastSyncNs() const { return lastSyncNs_; }
+qint64 TemperatureLogger::maxSyncNs() const { return maxSyncNs_; }
+qint64 TemperatureLogger::meanSyncNs() const {
+    return syncCount_ ? totalSyncNs_ / syncCount_ : 0;
+}
+
 void TemperatureLogger::start() {
-    // if (!temperatureProvider_) {
-    //     qWarning("TemperatureLogger: temperature provider is not set.");
-    //     return;
-    // }
     if (running_) return;
     running_ = true;
+    const qint64 trimmed = recoverTornTail(logPath_);
+    if (trimmed > 0)
+        qWarning("TemperatureLogger: dropped %lld bytes of torn last record.", trimmed);
     timer_->start(intervalMs_);
+    if (durability_ == GroupCommit)
+        syncTimer_->start(groupCommitMs_);
 }
 
 void TemperatureLogger::stop() {
     if (!running_) return;
     running_ = false;
     timer_->stop();
+    syncTimer_->stop();
+    closeLog();
 }
 
 void TemperatureLogger::onTick() {
-    const QString ts = nowTimestamp();
-    const double t = temperatureProvider_ ? temperatureProvider_ : qQNaN();
-    appendLine(formatCsvLine(ts, t));
+    // Время берём из отсчёта, а не из тика таймера. Если свежих отсчётов
+    // за два интервала не было — пишем текущее время и nan.
+    TimeSeriesStore::Sample last;
+    const bool have = store_ && store_->latest(TimeSeriesStore::Temperature, &last);
+    qint64 wallMs = last.wallMs;
+    double t = last.value;
+    if (!have || SampleClock::monotonicNs() - last.monoNs > 2 * qint64(intervalMs_) * 1000000) {
+        wallMs = QDateTime::currentMSecsSinceEpoch();
+        t = qQNaN();
+    }
+    const int len = formatCsvLine(line_, tsFormatter_.format(wallMs), t, ewma_, dutyCycle_);
+    appendRecord(line_, len);
     rotateIfNeeded();
 }
 
-void TemperatureLogger::appendLine(const QString& line) {
-    QFile f(logPath_);
+bool TemperatureLogger::openLog() {
+    if (file_.isOpen())
+        return true;
     // гарантируем директорию
     const QFileInfo fi(logPath_);
     if (!fi.absoluteDir().exists()) {
         QDir().mkpath(fi.absolutePath());
     }
-    if (!f.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+    if (!openWithFd(file_, logPath_, QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
         qWarning("TemperatureLogger: cannot open log file for append.");
-        return;
+        return false;
     }
-    QByteArray bytes = line.toUtf8();
-    bytes.append('\n');
-    if (f.write(bytes) != bytes.size()) {
+    return true;
+}
+
+void TemperatureLogger::closeLog() {
+    if (!file_.isOpen())
+        return;
+    if (durability_ != NoSync)
+        syncNow();
+    file_.close();
+}
+
+void TemperatureLogger::appendRecord(const char* data, int size) {
+    if (!openLog())
+        return;
+    // одна запись на строку — при сбое может оборваться только последняя
+    if (file_.write(data, size) != size) {
         qWarning("TemperatureLogger: failed to write log line.");
     }
-    f.flush();
-    f.close();
+    file_.flush();
+    dirty_ = true;
+    if (durability_ == SyncEachRecord)
+        syncNow();
+}
+
+void TemperatureLogger::syncNow() {
+    if (!dirty_ || !file_.isOpen())
+        return;
+    file_.flush();
+    QElapsedTimer t;
+    t.start();
+    if (!syncFileData(file_.handle())) {
+        qWarning("TemperatureLogger: fdatasync failed.");
+        return;
+    }
+    dirty_ = false;
+    lastSyncNs_ = t.nsecsElapsed();
+    maxSyncNs_ = qMax(maxSyncNs_, lastSyncNs_);
+    totalSyncNs_ += lastSyncNs_;
+    ++syncCount_;
+    emit synced(lastSyncNs_);
+}
+
+qint64 TemperatureLogger::recoverTornTail(const QString& path) {
+    QFile f;
+    if (!QFile::exists(path) || !openWithFd(f, path, QIODevice::ReadWrite))
+        return 0;
+    const qint64 size = f.size();
+    if (size == 0)
+        return 0;
+
+    // ищем последний перевод строки с конца, блоками
+    const qint64 chunk = 4096;
+    qint64 pos = size;
+    qint64 keep = 0;
+    while (pos > 0) {
+        const qint64 from = qMax<qint64>(0, pos - chunk);
+        f.seek(from);
+        const QByteArray buf = f.read(pos - from);
+        const int nl = buf.lastIndexOf('\n');
+        if (nl >= 0) {
+            keep = from + nl + 1;
+            break;
+        }
+        pos = from;
+    }
+    if (keep == size)
+        return 0;  // последняя запись целая
+    if (!f.resize(keep)) {
+        qWarning("TemperatureLogger: cannot trim torn record.");
+        return 0;
+    }
+    if (!syncFileData(f.handle()))
+        qWarning("TemperatureLogger: fdatasync after trim failed.");
+    return size - keep;
 }
 
 void TemperatureLogger::rotateIfNeeded() {
-    QFile f(logPath_);
-    if (!f.exists()) return;
-    if (!f.open(QIODevice::ReadOnly)) return;
-    const qint64 sz = f.size();
-    f.close();
+    const qint64 sz = file_.isOpen() ? file_.size() : QFileInfo(logPath_).size();
     if (sz >= maxBytes_) {
         rotateLogFile();
         pruneOldRotatedFiles();
@@ -117,27 +295,18 @@ void TemperatureLogger::rotateLogFile() {
         rotatedPath = dir.absoluteFilePath(rotatedName);
     }
 
-    // Закрыт ли файл — мы открываем его на запись только построчно, так что сейчас закрыт.
+    // Перед переименованием сбрасываем на диск и закрываем (Windows не
+    // переименует открытый файл). Rename атомарен: строка либо в старом
+    // файле, либо в новом — копии с последующей очисткой больше нет.
+    closeLog();
+
     if (!QFile::rename(logPath_, rotatedPath)) {
-        // fallback: копия+очистка
-        if (!QFile::copy(logPath_, rotatedPath)) {
-            qWarning("TemperatureLogger: rotation copy failed.");
-            return;
-        }
-        QFile orig(logPath_);
-        if (!orig.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-            qWarning("TemperatureLogger: cannot truncate original after copy.");
-        }
-        orig.close();
+        // продолжаем писать в текущий файл, ротацию повторим на следующем тике
+        qWarning("TemperatureLogger: rotation rename failed, will retry.");
         return;
     }
-
-    // создаём новый пустой лог
-    QFile newLog(logPath_);
-    if (!newLog.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
-        qWarning("TemperatureLogger: cannot create new log after rotation.");
-    }
-    newLog.close();
+    syncDirectory(dir.absolutePath());
+    // новый файл откроется при следующей записи
 }
 
 void TemperatureLogger::pruneOldRotatedFiles() {
@@ -164,13 +333,94 @@ void TemperatureLogger::pruneOldRotatedFiles() {
     }
 }
 
-QString TemperatureLogger::nowTimestamp() {
-    return QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
-}
 QString TemperatureLogger::tsForFilename() {
     return QDateTime::currentDateTime().toString("yyyy-MM-dd_HH-mm-ss");
 }
 
-QString TemperatureLogger::formatCsvLine(const QString& timestamp, double temperature) {
-    return QString("%1\t%2").arg(timestamp, QString::number(temperature, 'f', 2).replace("." , ","));
+namespace {
+
+// Число с фиксированной точностью и запятой вместо точки, как в старых логах
+int putDecimal(char* out, int cap, double v, int decimals) {
+    if (qIsNaN(v)) {
+        memcpy(out, "nan", 3);
+        return 3;
+    }
+    int n = snprintf(out, size_t(cap), "%.*f", decimals, v);
+    if (n < 0 || n >= cap)
+        n = cap - 1;
+    for (int i = 0; i < n; ++i)
+        if (out[i] == '.') out[i] = ',';
+    return n;
+}
+
+} // namespace
+
+// Колонки: время, температура, EWMA, скважность компрессора (%).
+// Первые две колонки не меняются — старые разборщики логов продолжают работать.
+// out должен вмещать не меньше 128 байт.
+bool TemperatureLogger::parseCsvLine(const QByteArray& line, Record* out) {
+    const QList<QByteArray> cols = line.trimmed().split('\t');
+    if (cols.size() < 2)
+        return false;
+    const QDateTime dt = QDateTime::fromString(QString::fromLatin1(cols[0]), "yyyy-MM-dd HH:mm:ss");
+    if (!dt.isValid())
+        return false;
+    bool ok = false;
+    const double v = QByteArray(cols[1]).replace(',', '.').toDouble(&ok);
+    if (!ok || qIsNaN(v))
+        return false;
+    out->wallMs = dt.toMSecsSinceEpoch();
+    out->temperature = v;
+    return true;
+}
+
+QVector<TemperatureLogger::Record> TemperatureLogger::readRecent(const QString& logPath,
+                                                                 qint64 fromWallMs, qint64 toWallMs) {
+    const qint64 TAIL_BYTES = 256 * 1024;   // ~6000 строк
+    const QFileInfo info(logPath);
+    // текущий лог и ротации: temperature_log.csv, temperature_log_*.csv
+    const QString pattern = QString("%1*.%2").arg(info.completeBaseName(), info.suffix());
+    const QFileInfoList files = info.absoluteDir().entryInfoList({pattern}, QDir::Files, QDir::Time);
+
+    QVector<Record> records;
+    for (const QFileInfo& fi : files) {
+        if (fi.lastModified().toMSecsSinceEpoch() < fromWallMs)
+            break;      // этот и более старые файлы целиком до интервала
+        QFile f(fi.absoluteFilePath());
+        if (!f.open(QIODevice::ReadOnly))
+            continue;
+        const qint64 offset = qMax<qint64>(0, f.size() - TAIL_BYTES);
+        f.seek(offset);
+        if (offset > 0)
+            f.readLine();   // оборванная первая строка
+        qint64 earliest = toWallMs;
+        Record r;
+        while (!f.atEnd()) {
+            if (!parseCsvLine(f.readLine(), &r))
+                continue;
+            earliest = qMin(earliest, r.wallMs);
+            if (r.wallMs >= fromWallMs && r.wallMs < toWallMs)
+                records.append(r);
+        }
+        if (earliest <= fromWallMs)
+            break;      // интервал покрыт — более старые файлы не нужны
+    }
+    std::sort(records.begin(), records.end(),
+              [](const Record& a, const Record& b) { return a.wallMs < b.wallMs; });
+    return records;
+}
+
+int TemperatureLogger::formatCsvLine(char* out, const char* timestamp, double temperature,
+                                     double ewma, double dutyCycle) {
+    char* p = out;
+    memcpy(p, timestamp, TimestampFormatter::Length);
+    p += TimestampFormatter::Length;
+    *p++ = '\t';
+    p += putDecimal(p, 32, temperature, 2);
+    *p++ = '\t';
+    p += putDecimal(p, 32, ewma, 2);
+    *p++ = '\t';
+    p += putDecimal(p, 32, dutyCycle * 100.0, 1);
+    *p++ = '\n';
+    return int(p - out);
 }
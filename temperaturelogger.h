@@ -3,6 +3,13 @@
 
 #include <QObject>
 #include <QString>
+#include <QFile>
+#include <QVector>
+
+#include "streamanalytics.h"
+#include "sampleclock.h"
+#include "timeseriesstore.h"
+#include "timestampformatter.h"
 
 class QTimer;
 
@@ -10,9 +17,20 @@ class TemperatureLogger : public QObject
 {
     Q_OBJECT
 public:
+    // Когда данные гарантированно попадают на диск
+    enum DurabilityMode {
+        NoSync,          // только flush в ОС — при отключении питания теряется кэш ОС
+        GroupCommit,     // fdatasync не чаще раза в groupCommitMs — теряется не больше этого окна
+        SyncEachRecord,  // fdatasync после каждой строки — максимум износа SSD
+    };
+    Q_ENUM(DurabilityMode)
+
     explicit TemperatureLogger(QObject* parent = nullptr);
+    ~TemperatureLogger();
 
-    void setTemperatureProvider(double provider);
+    // Источник температуры; в лог пишется последний отсчёт и время его чтения из устройства
+    void setStore(const TimeSeriesStore* store);
+    void setAnalytics(const AnalyticsSnapshot& snapshot); // EWMA и скважность в лог
 
     void setLogFilePath(const QString& path);
     QString logFilePath() const;
@@ -27,26 +45,73 @@ public:
     void setMaxRotatedFiles(int count); // по умолчанию 10
     int maxRotatedFiles() const;
 
+    void setDurability(DurabilityMode mode); // по умолчанию GroupCommit
+    DurabilityMode durability() const;
+
+    void setGroupCommitMs(int ms);      // окно группового fdatasync, по умолчанию 60000 мс
+    int groupCommitMs() const;
+
+    // Замеренная длительность fdatasync, нс
+    qint64 lastSyncNs() const;
+    qint64 maxSyncNs() const;
+    qint64 meanSyncNs() const;
+
+    // Обрезать недописанную последнюю строку (после сбоя питания).
+    // Возвращает число отброшенных байт.
+    static qint64 recoverTornTail(const QString& path);
+
+signals:
+    void synced(qint64 latencyNs);
+
 public slots:
     void start();
     void stop();
 
 private slots:
     void onTick();
+    void syncNow();
 
 private:
-    void appendLine(const QString& line);
+    bool openLog();
+    void closeLog();
+    void appendRecord(const char* data, int size);
     void rotateIfNeeded();
     void rotateLogFile();          // переименовать текущий лог и создать новый
     void pruneOldRotatedFiles();   // удалить старые, оставить maxRotatedFiles
 
-    static QString nowTimestamp(); // "YYYY-MM-DD HH:MM:SS"
     static QString tsForFilename(); // "YYYY-MM-DD_HH-mm-ss"
-    static QString formatCsvLine(const QString& timestamp, double temperature);
+    // Строка лога в out (без выделения памяти), возвращает длину с '\n'
+    static int formatCsvLine(char* out, const char* timestamp, double temperature,
+                             double ewma, double dutyCycle);
+
+    // Запись лога, прочитанная обратно
+    struct Record {
+        qint64 wallMs = 0;         // мс с эпохи
+        double temperature = 0.0;  // °C
+    };
+    // Обратное к formatCsvLine: "yyyy-MM-dd HH:mm:ss\t-1,23[\t...]". nan и мусор — false
+    static bool parseCsvLine(const QByteArray& line, Record* out);
+    // Записи из [fromWallMs, toWallMs) по хвостам текущего лога и его ротаций
+    // (от новых к старым, пока интервал не покрыт), по возрастанию времени.
+    // Без состояния — можно звать из пула потоков.
+    static QVector<Record> readRecent(const QString& logPath, qint64 fromWallMs, qint64 toWallMs);
 
 private:
     QTimer* timer_{nullptr};
-    double temperatureProvider_ = 0.0f;
+    QTimer* syncTimer_{nullptr};
+    QFile   file_;
+    bool    dirty_ = false;
+    DurabilityMode durability_ = GroupCommit;
+    int     groupCommitMs_ = 60000;
+    qint64  lastSyncNs_ = 0;
+    qint64  maxSyncNs_ = 0;
+    qint64  totalSyncNs_ = 0;
+    qint64  syncCount_ = 0;
+    const TimeSeriesStore* store_ = nullptr;
+    TimestampFormatter tsFormatter_;
+    char   line_[128];
+    double ewma_ = qQNaN();
+    double dutyCycle_ = qQNaN();
     QString logPath_ = QStringLiteral("temperature_log.csv");
     qint64  maxBytes_ = 1 * 1024 * 1024; // 1 МБ
     int     intervalMs_ = 15000;         // 15 сек
@@ -0,0 +1,124 @@
+#include "thermalmodel.h"
+#include "temperaturelogger.h"
+#include <QFile>
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+
+struct LogPoint {
+    qint64 t;      // мс с эпохи
+    double value;  // °C
+};
+
+} // namespace
+
+ThermalModel ThermalModel::fitFromLogs(const QStringList& files, double ambient, QString* error) {
+    ThermalModel m;
+    m.ambient = ambient;
+
+    QVector<LogPoint> points;
+    for (const QString& path : files) {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly))
+            continue;
+        TemperatureLogger::Record r;
+        while (!f.atEnd()) {
+            if (TemperatureLogger::parseCsvLine(f.readLine(), &r))
+                points.append({r.wallMs, r.temperature});
+        }
+    }
+    std::sort(points.begin(), points.end(),
+              [](const LogPoint& a, const LogPoint& b) { return a.t < b.t; });
+
+    // Нагрев: s = a * x, x = Tamb - T  =>  a = Σ(s·x) / Σ(x²)
+    double sxx = 0.0, sxy = 0.0;
+    int heating = 0;
+    for (int i = 1; i < points.size(); ++i) {
+        const double dt = (points[i].t - points[i - 1].t) / 1000.0;
+        if (dt <= 0 || dt > 120.0) continue;  // разрыв в логе
+        const double slope = (points[i].value - points[i - 1].value) / dt;
+        const double x = ambient - points[i - 1].value;
+        if (slope > 0) {
+            sxx += x * x;
+            sxy += slope * x;
+            ++heating;
+        }
+    }
+    if (heating < 10 || sxx <= 0) {
+        if (error) *error = QString("Недостаточно данных для подгонки: %1 точек нагрева").arg(heating);
+        return m;
+    }
+    m.leak = sxy / sxx;
+
+    // Охлаждение: b = mean(a * x - s)
+    double sumB = 0.0;
+    int cooling = 0;
+    for (int i = 1; i < points.size(); ++i) {
+        const double dt = (points[i].t - points[i - 1].t) / 1000.0;
+        if (dt <= 0 || dt > 120.0) continue;
+        const double slope = (points[i].value - points[i - 1].value) / dt;
+        if (slope < 0) {
+            sumB += m.leak * (ambient - points[i - 1].value) - slope;
+            ++cooling;
+        }
+    }
+    if (cooling < 10) {
+        if (error) *error = QString("Недостаточно данных для подгонки: %1 точек охлаждения").arg(cooling);
+        return m;
+    }
+    m.cooling = sumB / cooling;
+    m.pointsUsed = heating + cooling;
+    m.valid = m.leak > 0 && m.cooling > 0;
+    if (!m.valid && error)
+        *error = "Подгонка дала нефизичные коэффициенты";
+    return m;
+}
+
+double ThermalModel::derivative(double temperature, bool compressorOn) const {
+    return leak * (ambient - temperature) - (compressorOn ? cooling : 0.0);
+}
+
+SimulationResult simulateController(const ThermalModel& model,
+                                    const ControllerParams& params,
+                                    const SimulationSettings& s) {
+    SimulationResult r;
+    r.params = params;
+
+    const double cycle = qMax<quint32>(params.cycleTime, 1);
+    double T = s.setpoint + s.startOffset;
+    double prevErr = T - s.setpoint;
+    double cycleStart = 0.0;
+    double onUntil = -1.0;
+    bool on = false;
+    double lastOutOfBand = 0.0;
+
+    for (double t = 0.0; t < s.horizonSec; t += s.stepSec) {
+        if (t >= cycleStart) {
+            const double err = T - s.setpoint;
+            const double u = params.pidP * err + params.pidD * (err - prevErr) / cycle;
+            const double onSec = qBound(0.0, params.onTime * u, cycle);
+            onUntil = t + onSec;
+            prevErr = err;
+            cycleStart = t + cycle;
+        }
+        const bool nowOn = t < onUntil;
+        if (nowOn && !on)
+            ++r.starts;
+        on = nowOn;
+
+        T += model.derivative(T, on) * s.stepSec;
+
+        const double err = T - s.setpoint;
+        if (qAbs(err) > s.band)
+            lastOutOfBand = t + s.stepSec;
+        r.overshoot = qMax(r.overshoot, -err);
+    }
+
+    r.settlingSec = lastOutOfBand;
+    const double hours = s.horizonSec / 3600.0;
+    r.score = r.settlingSec / 3600.0
+              + s.weightOvershoot * r.overshoot
+              + s.weightStarts * r.starts / hours;
+    return r;
+}
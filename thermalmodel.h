@@ -0,0 +1,64 @@
+#ifndef THERMALMODEL_H
+#define THERMALMODEL_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Упрощённая тепловая модель камеры первого порядка:
+//   dT/dt = a * (Tamb - T) - b * u,   u = 1 — компрессор включён, 0 — выключен.
+// a — теплопритоки через стенки (1/с), b — холодопроизводительность (°C/с).
+struct ThermalModel {
+    double ambient = 20.0;          // температура снаружи, °C
+    double leak = 1.0 / 36000.0;    // a, 1/с
+    double cooling = 0.01;          // b, °C/с
+    int    pointsUsed = 0;          // сколько интервалов пошло в подгонку
+    bool   valid = false;
+
+    // Подогнать модель по логам temperature_log*.csv. Состояние компрессора
+    // в логах не пишется, поэтому нагрев считаем участками с выключенным
+    // компрессором, а охлаждение — с включённым.
+    static ThermalModel fitFromLogs(const QStringList& files, double ambient,
+                                    QString* error = nullptr);
+
+    double derivative(double temperature, bool compressorOn) const;
+};
+
+// Параметры регулятора, совпадают с командами 0x11–0x14
+struct ControllerParams {
+    double  pidP = 1.0;
+    double  pidD = 0.0;
+    quint32 onTime = 60;       // базовое время работы компрессора, с
+    quint32 cycleTime = 300;   // период цикла, с
+};
+
+struct SimulationSettings {
+    double setpoint = -2.0;
+    double startOffset = 3.0;       // начальное отклонение от уставки, °C
+    double band = 0.5;              // полоса «установилось», °C
+    double horizonSec = 6 * 3600.0; // длительность прогона
+    double stepSec = 1.0;           // шаг интегрирования
+
+    // Веса ранжирования: score = часы до установления
+    //   + wOvershoot * перерегулирование + wStarts * пусков в час
+    double weightOvershoot = 2.0;
+    double weightStarts = 0.5;
+};
+
+struct SimulationResult {
+    ControllerParams params;
+    double settlingSec = 0.0;   // когда температура окончательно вошла в полосу
+    double overshoot = 0.0;     // максимальный проход ниже уставки, °C
+    int    starts = 0;          // число включений компрессора
+    double score = 0.0;         // меньше — лучше
+};
+
+// Прогон регулятора на модели. Алгоритм прошивки в точности неизвестен,
+// поэтому моделируем так: в начале каждого цикла cycleTime считаем
+// u = P*e + D*de/dt (e = T - уставка) и включаем компрессор на
+// clamp(onTime * u, 0, cycleTime) секунд.
+SimulationResult simulateController(const ThermalModel& model,
+                                    const ControllerParams& params,
+                                    const SimulationSettings& settings);
+
+#endif // THERMALMODEL_H
@@ -0,0 +1,67 @@
+#include "timeseriesstore.h"
+
+TimeSeriesStore::TimeSeriesStore(int capacityLog2)
+    : capacity_(quint64(1) << qBound(6, capacityLog2, 24)),
+      mask_(capacity_ - 1)
+{
+    for (Ring& r : rings_) {
+        r.monoNs.reset(new std::atomic<qint64>[capacity_]);
+        r.wallMs.reset(new std::atomic<qint64>[capacity_]);
+        r.value.reset(new std::atomic<double>[capacity_]);
+        r.seq.reset(new std::atomic<quint64>[capacity_]);
+        for (quint64 i = 0; i < capacity_; ++i)
+            r.seq[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void TimeSeriesStore::append(Channel ch, qint64 monoNs, qint64 wallMs, double value) {
+    Ring& r = rings_[ch];
+    const quint64 h = r.head.load(std::memory_order_relaxed);
+    const quint64 slot = h & mask_;
+    // пометка «пишется» не должна уехать за запись полей
+    r.seq[slot].store(2 * h + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    r.monoNs[slot].store(monoNs, std::memory_order_relaxed);
+    r.wallMs[slot].store(wallMs, std::memory_order_relaxed);
+    r.value[slot].store(value, std::memory_order_relaxed);
+    r.seq[slot].store(2 * h + 2, std::memory_order_release);
+    r.head.store(h + 1, std::memory_order_release);
+}
+
+quint64 TimeSeriesStore::head(Channel ch) const {
+    return rings_[ch].head.load(std::memory_order_acquire);
+}
+
+quint64 TimeSeriesStore::oldest(Channel ch) const {
+    const quint64 h = head(ch);
+    const quint64 span = capacity_ - Guard;
+    return h > span ? h - span : 0;
+}
+
+bool TimeSeriesStore::at(Channel ch, quint64 index, Sample* out) const {
+    const Ring& r = rings_[ch];
+    if (index >= head(ch))
+        return false;
+    const quint64 slot = index & mask_;
+    const quint64 expected = 2 * index + 2;
+    if (r.seq[slot].load(std::memory_order_acquire) != expected)
+        return false;   // ячейка уже перезаписана или пишется
+    out->monoNs = r.monoNs[slot].load(std::memory_order_relaxed);
+    out->wallMs = r.wallMs[slot].load(std::memory_order_relaxed);
+    out->value = r.value[slot].load(std::memory_order_relaxed);
+    // писатель мог начать перезапись, пока мы копировали: тогда версия уже другая
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return r.seq[slot].load(std::memory_order_relaxed) == expected;
+}
+
+bool TimeSeriesStore::latest(Channel ch, Sample* out) const {
+    const quint64 h = head(ch);
+    return h > 0 && at(ch, h - 1, out);
+}
+
+TimeSeriesStore::Cursor TimeSeriesStore::subscribe(Channel ch, bool fromStart) const {
+    Cursor c;
+    c.channel = ch;
+    c.next = fromStart ? oldest(ch) : head(ch);
+    return c;
+}
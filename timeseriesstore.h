@@ -0,0 +1,91 @@
+#ifndef TIMESERIESSTORE_H
+#define TIMESERIESSTORE_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+
+// Общее хранилище временных рядов всех каналов (структура массивов).
+// Один писатель — поток HID, читателей сколько угодно и без блокировок:
+// каждый канал — кольцевой буфер, у каждой ячейки своя версия (seqlock).
+// Писатель помечает ячейку занятой (2·index+1), заполняет её и публикует
+// версию 2·index+2, затем счётчик записей (release). Читатель принимает копию,
+// только если версия до и после копирования одна и та же и равна 2·index+2 —
+// иначе писатель обошёл кольцо или пишет в ячейку прямо сейчас.
+class TimeSeriesStore {
+public:
+    enum Channel {
+        Temperature,
+        Setpoint,
+        PidP,
+        PidD,
+        OnTime,
+        CycleTime,
+        LinkState,      // 1 — устройство подключено, 0 — нет
+        ChannelCount
+    };
+
+    struct Sample {
+        qint64 monoNs = 0;
+        qint64 wallMs = 0;
+        double value = 0.0;
+    };
+
+    // Подписка: номер следующего непрочитанного отсчёта канала
+    struct Cursor {
+        Channel channel = Temperature;
+        quint64 next = 0;
+    };
+
+    explicit TimeSeriesStore(int capacityLog2 = 15);  // 32768 отсчётов на канал
+    TimeSeriesStore(const TimeSeriesStore&) = delete;
+    TimeSeriesStore& operator=(const TimeSeriesStore&) = delete;
+
+    // Только из потока-писателя
+    void append(Channel ch, qint64 monoNs, qint64 wallMs, double value);
+
+    quint64 capacity() const { return capacity_; }
+    quint64 head(Channel ch) const;      // сколько отсчётов записано всего
+    quint64 oldest(Channel ch) const;    // номер самого старого ещё доступного
+
+    bool at(Channel ch, quint64 index, Sample* out) const;
+    bool latest(Channel ch, Sample* out) const;
+
+    Cursor subscribe(Channel ch, bool fromStart = false) const;
+
+    // Передать в f(const Sample&) все новые отсчёты с позиции курсора.
+    // Отставший курсор перескакивает на самый старый доступный отсчёт.
+    template <typename F>
+    int read(Cursor& c, F&& f) const {
+        const quint64 h = head(c.channel);
+        if (c.next < oldest(c.channel))
+            c.next = oldest(c.channel);
+        int n = 0;
+        Sample s;
+        for (; c.next < h; ++c.next) {
+            if (!at(c.channel, c.next, &s))
+                continue;
+            f(s);
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    // Запас, чтобы не читать ячейку, которую писатель вот-вот перезапишет
+    static constexpr quint64 Guard = 16;
+
+    struct Ring {
+        std::unique_ptr<std::atomic<qint64>[]> monoNs;
+        std::unique_ptr<std::atomic<qint64>[]> wallMs;
+        std::unique_ptr<std::atomic<double>[]> value;
+        std::unique_ptr<std::atomic<quint64>[]> seq;   // 0 — пусто, нечётная — пишется
+        std::atomic<quint64> head{0};
+    };
+
+    quint64 capacity_;
+    quint64 mask_;
+    Ring rings_[ChannelCount];
+};
+
+#endif // TIMESERIESSTORE_H
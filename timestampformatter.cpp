@@ -0,0 +1,52 @@
+#include "timestampformatter.h"
+#include <QDateTime>
+
+namespace {
+
+inline void put2(char* p, int v) {
+    p[0] = char('0' + v / 10);
+    p[1] = char('0' + v % 10);
+}
+
+} // namespace
+
+const char* TimestampFormatter::format(qint64 wallMs) {
+    const qint64 sec = wallMs >= 0 ? wallMs / 1000 : (wallMs - 999) / 1000;
+    if (sec == lastSec_)
+        return buf_;
+
+    const qint64 off = sec - hourStartSec_;
+    if (lastSec_ < 0 || off < 0 || off >= 3600) {
+        formatFull(sec);
+    } else {
+        // "yyyy-MM-dd HH:mm:ss": минуты с 14-й позиции, секунды с 17-й
+        put2(buf_ + 14, int(off / 60));
+        put2(buf_ + 17, int(off % 60));
+    }
+    lastSec_ = sec;
+    return buf_;
+}
+
+void TimestampFormatter::formatFull(qint64 sec) {
+    const QDateTime dt = QDateTime::fromSecsSinceEpoch(sec);
+    const QDate d = dt.date();
+    const QTime t = dt.time();
+
+    const int y = d.year();
+    buf_[0] = char('0' + (y / 1000) % 10);
+    buf_[1] = char('0' + (y / 100) % 10);
+    put2(buf_ + 2, y % 100);
+    buf_[4] = '-';
+    put2(buf_ + 5, d.month());
+    buf_[7] = '-';
+    put2(buf_ + 8, d.day());
+    buf_[10] = ' ';
+    put2(buf_ + 11, t.hour());
+    buf_[13] = ':';
+    put2(buf_ + 14, t.minute());
+    buf_[16] = ':';
+    put2(buf_ + 17, t.second());
+    buf_[Length] = '\0';
+
+    hourStartSec_ = sec - (t.minute() * 60 + t.second());
+}
@@ -0,0 +1,25 @@
+#ifndef TIMESTAMPFORMATTER_H
+#define TIMESTAMPFORMATTER_H
+
+#include <QtGlobal>
+
+// Форматирование "yyyy-MM-dd HH:mm:ss" (местное время) без выделения памяти.
+// Строка кэшируется: в пределах одного часа переписываются только минуты и
+// секунды, полный пересчёт через QDateTime — раз в час (так же ловится
+// переход на летнее время).
+class TimestampFormatter {
+public:
+    static constexpr int Length = 19;
+
+    // Возвращает указатель на внутренний буфер длиной Length (+ '\0')
+    const char* format(qint64 wallMs);
+
+private:
+    void formatFull(qint64 sec);
+
+    char   buf_[Length + 1] = {};
+    qint64 lastSec_ = -1;
+    qint64 hourStartSec_ = 0;   // начало текущего местного часа, с эпохи
+};
+
+#endif // TIMESTAMPFORMATTER_H